@@ -27,6 +27,7 @@
 #include "ns3/string.h"
 #include "ns3/pointer.h"
 #include "ns3/boolean.h"
+#include "ns3/uinteger.h"
 
 #include "qos-tag.h"
 #include "wifi-phy.h"
@@ -34,10 +35,13 @@
 #include "mac-rx-middle.h"
 #include "mac-tx-middle.h"
 #include "mgt-headers.h"
+#include "vendor-mgt-headers.h"
 #include "mac-low.h"
 #include "amsdu-subframe-header.h"
 #include "msdu-aggregator.h"
 
+#include <algorithm>
+
 NS_LOG_COMPONENT_DEFINE ("ApWifiMac");
 
 namespace ns3 {
@@ -69,6 +73,60 @@ ApWifiMac::GetTypeId (void)
                    MakeBooleanAccessor (&ApWifiMac::SetBeaconGeneration,
                                         &ApWifiMac::GetBeaconGeneration),
                    MakeBooleanChecker ())
+    .AddAttribute ("UplinkGroups", "The number of groups between which the uplink access windows "
+                   "announced in the beacons are shared (0 or 1 to let all STAs contend at any time). "
+                   "A STA belongs to the group given by its MAC address modulo the number of groups, "
+                   "not to its group of the downlink scheduler. Only the DCF of the STAs is gated: "
+                   "their EDCA functions, and so the traffic of QoS STAs, contend at any time.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&ApWifiMac::m_uplinkGroups),
+                   MakeUintegerChecker<uint8_t> ())
+    .AddAttribute ("UplinkWindow", "The duration of the uplink access window of each group.",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&ApWifiMac::m_uplinkWindow),
+                   MakeTimeChecker (MicroSeconds (1)))
+    .AddAttribute ("CfpInterval", "The number of beacons between two contention-free periods, "
+                   "during which the CF-Pollable stations are polled (0 to disable them).",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&ApWifiMac::m_cfpInterval),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("CfpMaxDuration", "The maximum duration of a contention-free period, "
+                   "at most 32767 us, the largest duration the CF-Polls can announce.",
+                   TimeValue (MilliSeconds (20)),
+                   MakeTimeAccessor (&ApWifiMac::m_cfpMaxDuration),
+                   MakeTimeChecker (Time (0), MicroSeconds (32767)))
+    .AddAttribute ("BackoffCycleLength", "The number of backoff slots given to the stations in the "
+                   "association responses, for a deterministic backoff (0 to let them draw random backoffs).",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&ApWifiMac::m_backoffCycleLength),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("MulticastToUnicastThreshold", "The largest number of members of a group for which "
+                   "the group addressed data frames are sent as unicast copies to each member, "
+                   "at its own rate and with ACKs (0 to always send them to the group address).",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&ApWifiMac::m_multicastToUnicastThreshold),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("BssLoad", "Whether beacons and probe responses advertise the number of associated "
+                   "stations and the channel utilization, for the STAs to pick the least loaded AP.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&ApWifiMac::m_advertiseBssLoad),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MaxStations", "The number of associated stations above which new stations are "
+                   "refused, and redirected to the SteeringTarget if any (0 for no limit).",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&ApWifiMac::m_maxStations),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("SteeringTarget", "The BSSID of the AP to which the refused stations are redirected "
+                   "(00:00:00:00:00:00 for none).",
+                   Mac48AddressValue (Mac48Address ("00:00:00:00:00:00")),
+                   MakeMac48AddressAccessor (&ApWifiMac::m_steeringTarget),
+                   MakeMac48AddressChecker ())
+    .AddAttribute ("DirectIntraBssRelay", "Whether the unicast frames from one associated station to another "
+                   "are sent on with their received header, only readdressed, instead of being forwarded up "
+                   "to this node and rebuilt on the way down.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&ApWifiMac::m_directIntraBssRelay),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
@@ -82,11 +140,23 @@ ApWifiMac::ApWifiMac ()
   m_beaconDca->SetMaxCw (0);
   m_beaconDca->SetLow (m_low);
   m_beaconDca->SetManager (m_dcfManager);
+  m_beaconDca->SetTxOkCallback (MakeCallback (&ApWifiMac::CfPollSent, this));
+
+  // the downlink scheduler finds the associated stations by AID
+  m_associations = Create<AssociationTable> ();
+  m_dca->SetAssociationTable (m_associations);
+  m_beaconDca->SetAssociationTable (m_associations);
 
   // Let the lower layers know that we are acting as an AP.
   SetTypeOfStation (AP);
 
   m_enableBeaconGeneration = false;
+  m_beaconCount = 0;
+  m_cfp = false;
+  m_templatesValid = false;
+  m_templateHtSupported = false;
+  m_channelUtilization = 0;
+  m_directIntraBssRelay = false;
 }
 
 ApWifiMac::~ApWifiMac ()
@@ -101,6 +171,13 @@ ApWifiMac::DoDispose ()
   m_beaconDca = 0;
   m_enableBeaconGeneration = false;
   m_beaconEvent.Cancel ();
+  m_cfPollTimeoutEvent.Cancel ();
+  m_cfPollList.clear ();
+  m_cfPollable.Clear ();
+  m_backoffSlots.Clear ();
+  m_backoffSlotUsers.clear ();
+  m_associations = 0;
+  m_multicastMembers.Clear ();
   RegularWifiMac::DoDispose ();
 }
 
@@ -114,6 +191,31 @@ ApWifiMac::SetAddress (Mac48Address address)
   RegularWifiMac::SetBssid (address);
 }
 
+void
+ApWifiMac::SetSsid (Ssid ssid)
+{
+  NS_LOG_FUNCTION (this << ssid);
+  RegularWifiMac::SetSsid (ssid);
+  InvalidateTemplates ();
+}
+
+void
+ApWifiMac::SetWifiPhy (Ptr<WifiPhy> phy)
+{
+  NS_LOG_FUNCTION (this << phy);
+  RegularWifiMac::SetWifiPhy (phy);
+  InvalidateTemplates ();
+}
+
+void
+ApWifiMac::FinishConfigureStandard (enum WifiPhyStandard standard)
+{
+  NS_LOG_FUNCTION (this << standard);
+  RegularWifiMac::FinishConfigureStandard (standard);
+  // the PHY modes may have changed with the standard
+  InvalidateTemplates ();
+}
+
 void
 ApWifiMac::SetBeaconGeneration (bool enable)
 {
@@ -149,6 +251,7 @@ ApWifiMac::SetWifiRemoteStationManager (Ptr<WifiRemoteStationManager> stationMan
   NS_LOG_FUNCTION (this << stationManager);
   m_beaconDca->SetWifiRemoteStationManager (stationManager);
   RegularWifiMac::SetWifiRemoteStationManager (stationManager);
+  InvalidateTemplates ();
 }
 
 void
@@ -172,6 +275,7 @@ ApWifiMac::SetBeaconInterval (Time interval)
       NS_LOG_WARN ("beacon interval should be multiple of 1024us, see IEEE Std. 802.11-2007, section 11.1.1.1");
     }
   m_beaconInterval = interval;
+  InvalidateTemplates ();
 }
 
 void
@@ -181,6 +285,46 @@ ApWifiMac::StartBeaconing (void)
   SendOneBeacon ();
 }
 
+Ptr<AssociationTable>
+ApWifiMac::GetAssociationTable (void) const
+{
+  return m_associations;
+}
+
+void
+ApWifiMac::AddMulticastMember (Mac48Address group, Mac48Address station)
+{
+  NS_LOG_FUNCTION (this << group << station);
+  NS_ASSERT (group.IsGroup () && !group.IsBroadcast ());
+  uint64_t key = MacAddressHashMap<std::list<Mac48Address> >::GetKey (group);
+  std::list<Mac48Address> *members = m_multicastMembers.Find (key);
+  if (members == 0)
+    {
+      members = m_multicastMembers.Insert (key, std::list<Mac48Address> ());
+    }
+  if (std::find (members->begin (), members->end (), station) == members->end ())
+    {
+      members->push_back (station);
+    }
+}
+
+void
+ApWifiMac::RemoveMulticastMember (Mac48Address group, Mac48Address station)
+{
+  NS_LOG_FUNCTION (this << group << station);
+  uint64_t key = MacAddressHashMap<std::list<Mac48Address> >::GetKey (group);
+  std::list<Mac48Address> *members = m_multicastMembers.Find (key);
+  if (members == 0)
+    {
+      return;
+    }
+  members->remove (station);
+  if (members->empty ())
+    {
+      m_multicastMembers.Erase (key);
+    }
+}
+
 int64_t
 ApWifiMac::AssignStreams (int64_t stream)
 {
@@ -220,6 +364,10 @@ ApWifiMac::ForwardDown (Ptr<const Packet> packet, Mac48Address from,
                         Mac48Address to, uint8_t tid)
 {
   NS_LOG_FUNCTION (this << packet << from << to << static_cast<uint32_t> (tid));
+  if (to.IsGroup () && ForwardDownAsUnicast (packet, from, to, tid))
+    {
+      return;
+    }
   WifiMacHeader hdr;
 
   // For now, an AP that supports QoS does not support non-QoS
@@ -268,7 +416,7 @@ void
 ApWifiMac::Enqueue (Ptr<const Packet> packet, Mac48Address to, Mac48Address from)
 {
   NS_LOG_FUNCTION (this << packet << to << from);
-  if (to.IsBroadcast () || m_stationManager->IsAssociated (to))
+  if (to.IsBroadcast () || m_associations->IsAssociated (to))
     {
       ForwardDown (packet, from, to);
     }
@@ -284,6 +432,95 @@ ApWifiMac::Enqueue (Ptr<const Packet> packet, Mac48Address to)
   Enqueue (packet, to, m_low->GetAddress ());
 }
 
+bool
+ApWifiMac::RelayInBss (Ptr<const Packet> packet, const WifiMacHeader *hdr,
+                       Mac48Address from, Mac48Address to)
+{
+  NS_LOG_FUNCTION (this << packet << hdr << from << to);
+  if (hdr->IsQosData () != m_qosSupported)
+    {
+      // the frame must change type
+      return false;
+    }
+  WifiMacHeader relay = *hdr;
+  relay.SetAddr1 (to);
+  relay.SetAddr2 (GetAddress ());
+  relay.SetAddr3 (from);
+  relay.SetDsFrom ();
+  relay.SetDsNotTo ();
+  relay.SetNoRetry ();
+  relay.SetFragmentNumber (0);
+  relay.SetNoMoreFragments ();
+  if (m_htSupported)
+    {
+      relay.SetNoOrder ();
+    }
+  if (m_qosSupported)
+    {
+      relay.SetQosAckPolicy (WifiMacHeader::NORMAL_ACK);
+      relay.SetQosNoEosp ();
+      relay.SetQosNoAmsdu ();
+      relay.SetQosTxopLimit (0);
+      m_edca[QosUtilsMapTidToAc (relay.GetQosTid ())]->Queue (packet, relay);
+    }
+  else
+    {
+      m_dca->Queue (packet, relay);
+    }
+  return true;
+}
+
+bool
+ApWifiMac::ForwardDownAsUnicast (Ptr<const Packet> packet, Mac48Address from,
+                                 Mac48Address to, uint8_t tid)
+{
+  NS_LOG_FUNCTION (this << packet << from << to << static_cast<uint32_t> (tid));
+  if (m_multicastToUnicastThreshold == 0)
+    {
+      return false;
+    }
+  std::list<Mac48Address> members;
+  if (to.IsBroadcast ())
+    {
+      if (m_associations->GetNStations () > m_multicastToUnicastThreshold)
+        {
+          return false;
+        }
+      members = m_associations->GetStations ();
+    }
+  else
+    {
+      std::list<Mac48Address> *group = m_multicastMembers.Find (MacAddressHashMap<std::list<Mac48Address> >::GetKey (to));
+      if (group == 0)
+        {
+          // nobody told us who the members are
+          return false;
+        }
+      for (std::list<Mac48Address>::const_iterator i = group->begin (); i != group->end (); i++)
+        {
+          if (m_associations->IsAssociated (*i))
+            {
+              members.push_back (*i);
+            }
+        }
+      if (members.size () > m_multicastToUnicastThreshold)
+        {
+          return false;
+        }
+    }
+  // the receivers still see the group address in the headers of the
+  // upper layers, only the destination of the MAC header changes
+  for (std::list<Mac48Address>::const_iterator i = members.begin (); i != members.end (); i++)
+    {
+      if (*i != from)
+        {
+          NS_LOG_DEBUG ("unicast copy of a frame for group=" << to << " to sta=" << *i);
+          ForwardDown (packet->Copy (), from, *i, tid);
+        }
+    }
+  return true;
+}
+
 bool
 ApWifiMac::SupportsSendFrom (void) const
 {
@@ -348,17 +585,16 @@ ApWifiMac::SendProbeResp (Mac48Address to)
   hdr.SetAddr3 (GetAddress ());
   hdr.SetDsNotFrom ();
   hdr.SetDsNotTo ();
-  Ptr<Packet> packet = Create<Packet> ();
-  MgtProbeResponseHeader probe;
-  probe.SetSsid (GetSsid ());
-  probe.SetSupportedRates (GetSupportedRates ());
-  probe.SetBeaconIntervalUs (m_beaconInterval.GetMicroSeconds ());
-if (m_htSupported)
+  if (m_htSupported)
     {
-      probe.SetHtCapabilities (GetHtCapabilities());
       hdr.SetNoOrder();
     }
-  packet->AddHeader (probe);
+  UpdateTemplates ();
+  Ptr<Packet> packet = CopyTemplate (m_probeRespTemplate);
+  if (m_advertiseBssLoad)
+    {
+      AddBssLoad (packet);
+    }
 
   // The standard is not clear on the correct queue for management
   // frames if we are a QoS AP. The approach taken here is to always
@@ -368,9 +604,9 @@ if (m_htSupported)
 }
 
 void
-ApWifiMac::SendAssocResp (Mac48Address to, bool success)
+ApWifiMac::SendAssocResp (Mac48Address to, bool success, bool redirect)
 {
-  NS_LOG_FUNCTION (this << to << success);
+  NS_LOG_FUNCTION (this << to << success << redirect);
   WifiMacHeader hdr;
   hdr.SetAssocResp ();
   hdr.SetAddr1 (to);
@@ -389,14 +625,28 @@ ApWifiMac::SendAssocResp (Mac48Address to, bool success)
     {
       code.SetFailure ();
     }
-  assoc.SetSupportedRates (GetSupportedRates ());
+  UpdateTemplates ();
+  assoc.SetSupportedRates (m_templateRates);
   assoc.SetStatusCode (code);
 
  if (m_htSupported)
     {
-      assoc.SetHtCapabilities (GetHtCapabilities());
+      assoc.SetHtCapabilities (m_templateHtCapabilities);
       hdr.SetNoOrder();
     }
+  if (success && m_backoffCycleLength > 0)
+    {
+      BackoffSlotHeader backoffSlot;
+      backoffSlot.SetSlot (AssignBackoffSlot (to));
+      backoffSlot.SetCycleLength (m_backoffCycleLength);
+      packet->AddHeader (backoffSlot);
+    }
+  if (!success && redirect && m_steeringTarget != Mac48Address ("00:00:00:00:00:00"))
+    {
+      BssRedirectHeader redirection;
+      redirection.SetTarget (m_steeringTarget);
+      packet->AddHeader (redirection);
+    }
   packet->AddHeader (assoc);
 
   // The standard is not clear on the correct queue for management
@@ -406,6 +656,49 @@ ApWifiMac::SendAssocResp (Mac48Address to, bool success)
   m_dca->Queue (packet, hdr);
 }
 
+uint16_t
+ApWifiMac::AssignBackoffSlot (Mac48Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+  uint64_t key = MacAddressHashMap<uint16_t>::GetKey (address);
+  uint16_t *slot = m_backoffSlots.Find (key);
+  if (slot != 0 && *slot < m_backoffCycleLength)
+    {
+      return *slot;
+    }
+  ReleaseBackoffSlot (address);
+  m_backoffSlotUsers.resize (m_backoffCycleLength, 0);
+  uint16_t best = 0;
+  for (uint16_t i = 1; i < m_backoffCycleLength; i++)
+    {
+      if (m_backoffSlotUsers[i] < m_backoffSlotUsers[best])
+        {
+          best = i;
+        }
+    }
+  m_backoffSlotUsers[best]++;
+  m_backoffSlots.Insert (key, best);
+  NS_LOG_DEBUG ("sta=" << address << " gets backoff slot " << best);
+  return best;
+}
+
+void
+ApWifiMac::ReleaseBackoffSlot (Mac48Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+  uint64_t key = MacAddressHashMap<uint16_t>::GetKey (address);
+  uint16_t *slot = m_backoffSlots.Find (key);
+  if (slot == 0)
+    {
+      return;
+    }
+  if (*slot < m_backoffSlotUsers.size ())
+    {
+      m_backoffSlotUsers[*slot]--;
+    }
+  m_backoffSlots.Erase (key);
+}
+
 void
 ApWifiMac::SendOneBeacon (void)
 {
@@ -417,21 +710,235 @@ ApWifiMac::SendOneBeacon (void)
   hdr.SetAddr3 (GetAddress ());
   hdr.SetDsNotFrom ();
   hdr.SetDsNotTo ();
-  Ptr<Packet> packet = Create<Packet> ();
-  MgtBeaconHeader beacon;
-  beacon.SetSsid (GetSsid ());
-  beacon.SetSupportedRates (GetSupportedRates ());
-  beacon.SetBeaconIntervalUs (m_beaconInterval.GetMicroSeconds ());
   if (m_htSupported)
     {
-      beacon.SetHtCapabilities (GetHtCapabilities());
       hdr.SetNoOrder();
     }
-  packet->AddHeader (beacon);
+  UpdateTemplates ();
+  Ptr<Packet> packet = CopyTemplate (m_beaconTemplate);
+  if (m_uplinkGroups > 1)
+    {
+      UplinkWindowHeader uplinkWindow;
+      uplinkWindow.SetGroups (m_uplinkGroups);
+      uplinkWindow.SetWindowDuration (m_uplinkWindow);
+      Ptr<Packet> element = Create<Packet> ();
+      element->AddHeader (uplinkWindow);
+      packet->AddAtEnd (element);
+    }
+  if (m_advertiseBssLoad)
+    {
+      UpdateChannelUtilization ();
+      AddBssLoad (packet);
+    }
 
   // The beacon has it's own special queue, so we load it in there
   m_beaconDca->Queue (packet, hdr);
   m_beaconEvent = Simulator::Schedule (m_beaconInterval, &ApWifiMac::SendOneBeacon, this);
+
+  if (m_cfpInterval > 0 && !m_cfp && ++m_beaconCount >= m_cfpInterval)
+    {
+      m_beaconCount = 0;
+      StartCfp ();
+    }
+}
+
+void
+ApWifiMac::UpdateTemplates (void)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t nBasicModes = m_stationManager->GetNBasicModes ();
+  bool valid = m_templatesValid
+    && m_templateHtSupported == m_htSupported
+    && m_templateBasicModes.size () == nBasicModes;
+  for (uint32_t i = 0; valid && i < nBasicModes; i++)
+    {
+      valid = m_templateBasicModes[i] == m_stationManager->GetBasicMode (i);
+    }
+  if (valid)
+    {
+      return;
+    }
+  m_templateRates = GetSupportedRates ();
+  if (m_htSupported)
+    {
+      m_templateHtCapabilities = GetHtCapabilities ();
+    }
+  MgtBeaconHeader beacon;
+  beacon.SetSsid (GetSsid ());
+  beacon.SetSupportedRates (m_templateRates);
+  beacon.SetBeaconIntervalUs (m_beaconInterval.GetMicroSeconds ());
+  if (m_htSupported)
+    {
+      beacon.SetHtCapabilities (m_templateHtCapabilities);
+    }
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (beacon);
+  m_beaconTemplate.resize (packet->GetSize ());
+  packet->CopyData (&m_beaconTemplate[0], packet->GetSize ());
+
+  // a probe response has the same fields as a beacon
+  MgtProbeResponseHeader probe = beacon;
+  packet = Create<Packet> ();
+  packet->AddHeader (probe);
+  m_probeRespTemplate.resize (packet->GetSize ());
+  packet->CopyData (&m_probeRespTemplate[0], packet->GetSize ());
+
+  m_templatesValid = true;
+  m_templateHtSupported = m_htSupported;
+  m_templateBasicModes.clear ();
+  for (uint32_t i = 0; i < nBasicModes; i++)
+    {
+      m_templateBasicModes.push_back (m_stationManager->GetBasicMode (i));
+    }
+}
+
+void
+ApWifiMac::InvalidateTemplates (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_templatesValid = false;
+}
+
+Ptr<Packet>
+ApWifiMac::CopyTemplate (const std::vector<uint8_t> &tmpl) const
+{
+  NS_LOG_FUNCTION (this);
+  // the timestamp is the first field of the body, in little endian
+  std::vector<uint8_t> body = tmpl;
+  uint64_t timestamp = Simulator::Now ().GetMicroSeconds ();
+  for (uint32_t i = 0; i < 8; i++)
+    {
+      body[i] = (timestamp >> (8 * i)) & 0xff;
+    }
+  return Create<Packet> (&body[0], body.size ());
+}
+
+void
+ApWifiMac::UpdateChannelUtilization (void)
+{
+  NS_LOG_FUNCTION (this);
+  // the medium is busy for the PHY while it transmits, receives, or
+  // senses energy, which are mutually exclusive
+  Time busy = m_dcfManager->GetBusyTime (DcfManager::BUSY_TX)
+    + m_dcfManager->GetBusyTime (DcfManager::BUSY_RX)
+    + m_dcfManager->GetBusyTime (DcfManager::BUSY_CCA);
+  Time now = Simulator::Now ();
+  Time elapsed = now - m_lastUtilizationUpdate;
+  if (elapsed.IsStrictlyPositive ())
+    {
+      // the statistics of the DcfManager may have been reset
+      Time delta = busy >= m_lastBusyTime ? busy - m_lastBusyTime : busy;
+      double utilization = std::min (1.0, delta.GetSeconds () / elapsed.GetSeconds ());
+      m_channelUtilization = static_cast<uint8_t> (utilization * 255 + 0.5);
+    }
+  m_lastBusyTime = busy;
+  m_lastUtilizationUpdate = now;
+}
+
+void
+ApWifiMac::AddBssLoad (Ptr<Packet> packet) const
+{
+  NS_LOG_FUNCTION (this << packet);
+  BssLoadHeader load;
+  load.SetStationCount (std::min<uint32_t> (m_associations->GetNStations (), 0xffff));
+  load.SetChannelUtilization (m_channelUtilization);
+  // vendor elements follow the body of the beacon or probe response
+  Ptr<Packet> element = Create<Packet> ();
+  element->AddHeader (load);
+  packet->AddAtEnd (element);
+}
+
+void
+ApWifiMac::StartCfp (void)
+{
+  NS_LOG_FUNCTION (this);
+  // the stations served by the downlink scheduler are the ones sending
+  // TCP ACKs back, so they are likely to be backlogged
+  m_cfPollList.clear ();
+  std::list<Mac48Address> order = m_dca->GetSchedulerOrder ();
+  for (std::list<Mac48Address>::const_iterator i = order.begin (); i != order.end (); i++)
+    {
+      if (m_cfPollable.Find (MacAddressHashMap<bool>::GetKey (*i)) != 0
+          && m_associations->IsAssociated (*i))
+        {
+          m_cfPollList.push_back (*i);
+        }
+    }
+  if (m_cfPollList.empty ())
+    {
+      NS_LOG_DEBUG ("no station to poll");
+      return;
+    }
+  m_cfp = true;
+  m_cfpEnd = Simulator::Now () + m_cfpMaxDuration;
+  SendNextCfPoll ();
+}
+
+void
+ApWifiMac::SendNextCfPoll (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_cfPollList.empty () || Simulator::Now () >= m_cfpEnd)
+    {
+      EndCfp ();
+      return;
+    }
+  m_cfPolled = m_cfPollList.front ();
+  m_cfPollList.pop_front ();
+  NS_LOG_DEBUG ("poll sta=" << m_cfPolled);
+  WifiMacHeader hdr;
+  hdr.SetType (WIFI_MAC_DATA_NULL_CFPOLL);
+  hdr.SetAddr1 (m_cfPolled);
+  hdr.SetAddr2 (GetAddress ());
+  hdr.SetAddr3 (GetAddress ());
+  hdr.SetDsFrom ();
+  hdr.SetDsNotTo ();
+  // the other stations keep their NAV set until the end of the period
+  hdr.SetDuration (m_cfpEnd - Simulator::Now ());
+  m_beaconDca->QueueUnscheduled (Create<Packet> (), hdr);
+}
+
+void
+ApWifiMac::EndCfp (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_cfp = false;
+  m_cfPollList.clear ();
+  WifiMacHeader hdr;
+  hdr.SetType (WIFI_MAC_DATA_NULL_CFPOLL);
+  hdr.SetAddr1 (Mac48Address::GetBroadcast ());
+  hdr.SetAddr2 (GetAddress ());
+  hdr.SetAddr3 (GetAddress ());
+  hdr.SetDsFrom ();
+  hdr.SetDsNotTo ();
+  hdr.SetDuration (Seconds (0.0));
+  m_beaconDca->QueueUnscheduled (Create<Packet> (), hdr);
+}
+
+void
+ApWifiMac::CfPollSent (const WifiMacHeader &hdr)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_cfp && hdr.GetAddr1 () == m_cfPolled)
+    {
+      m_cfPollTimeoutEvent = Simulator::Schedule (GetPifs (), &ApWifiMac::CfPollTimeout, this);
+    }
+}
+
+void
+ApWifiMac::CfPollTimeout (void)
+{
+  NS_LOG_FUNCTION (this);
+  Time delay = m_phy->GetDelayUntilIdle ();
+  if (delay.IsStrictlyPositive ())
+    {
+      // wait for the end of what may be the answer: Receive polls the
+      // next station if it is
+      m_cfPollTimeoutEvent = Simulator::Schedule (delay + GetPifs (), &ApWifiMac::CfPollTimeout, this);
+      return;
+    }
+  NS_LOG_DEBUG ("no answer from sta=" << m_cfPolled);
+  SendNextCfPoll ();
 }
 
 void
@@ -444,6 +951,12 @@ ApWifiMac::TxOk (const WifiMacHeader &hdr)
       && m_stationManager->IsWaitAssocTxOk (hdr.GetAddr1 ()))
     {
       NS_LOG_DEBUG ("associated with sta=" << hdr.GetAddr1 ());
+      if (m_associations->Associate (hdr.GetAddr1 ()) == 0)
+        {
+          NS_LOG_WARN ("no AID left for sta=" << hdr.GetAddr1 ());
+          m_stationManager->RecordDisassociated (hdr.GetAddr1 ());
+          return;
+        }
       m_stationManager->RecordGotAssocTxOk (hdr.GetAddr1 ());
     }
 }
@@ -469,13 +982,24 @@ ApWifiMac::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
 
   Mac48Address from = hdr->GetAddr2 ();
 
+  if (m_cfp
+      && from == m_cfPolled
+      && m_cfPollTimeoutEvent.IsRunning ())
+    {
+      // the polled station answered: it may have more to send, so poll
+      // it again after the others
+      m_cfPollTimeoutEvent.Cancel ();
+      m_cfPollList.push_back (from);
+      SendNextCfPoll ();
+    }
+
   if (hdr->IsData ())
     {
       Mac48Address bssid = hdr->GetAddr1 ();
       if (!hdr->IsFromDs ()
           && hdr->IsToDs ()
           && bssid == GetAddress ()
-          && m_stationManager->IsAssociated (from))
+          && m_associations->IsAssociated (from))
         {
           Mac48Address to = hdr->GetAddr3 ();
           if (to == GetAddress ())
@@ -500,9 +1024,16 @@ ApWifiMac::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
                 }
             }
           else if (to.IsGroup ()
-                   || m_stationManager->IsAssociated (to))
+                   || m_associations->IsAssociated (to))
             {
               NS_LOG_DEBUG ("forwarding frame from=" << from << ", to=" << to);
+              if (m_directIntraBssRelay
+                  && !to.IsGroup ()
+                  && !(hdr->IsQosData () && hdr->IsQosAmsdu ())
+                  && RelayInBss (packet, hdr, from, to))
+                {
+                  return;
+                }
               Ptr<Packet> copy = packet->Copy ();
 
               // If the frame we are forwarding is of type QoS Data,
@@ -554,6 +1085,17 @@ ApWifiMac::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
               // rate set is compatible with our Basic Rate set
               MgtAssocRequestHeader assocReq;
               packet->RemoveHeader (assocReq);
+              bool cfPollable = false;
+              uint8_t subtype;
+              uint32_t size;
+              while (VendorSpecificElement::Peek (packet, &subtype, &size))
+                {
+                  if (subtype == VendorSpecificElement::CF_POLLABLE)
+                    {
+                      cfPollable = true;
+                    }
+                  packet->RemoveAtStart (size);
+                }
               SupportedRates rates = assocReq.GetSupportedRates ();
               bool problem = false;
               for (uint32_t i = 0; i < m_stationManager->GetNBasicModes (); i++)
@@ -584,7 +1126,14 @@ ApWifiMac::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
                   // one of the Basic Rate set mode is not
                   // supported by the station. So, we return an assoc
                   // response with an error status.
-                  SendAssocResp (hdr->GetAddr2 (), false);
+                  SendAssocResp (hdr->GetAddr2 (), false, false);
+                }
+              else if (m_maxStations > 0
+                       && !m_associations->IsAssociated (from)
+                       && m_associations->GetNStations () >= m_maxStations)
+                {
+                  NS_LOG_DEBUG ("full, refusing sta=" << from);
+                  SendAssocResp (hdr->GetAddr2 (), false, true);
                 }
               else
                 {
@@ -611,15 +1160,29 @@ ApWifiMac::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
                            }
                         }
                      }
+                  if (cfPollable)
+                    {
+                      m_cfPollable.Insert (MacAddressHashMap<bool>::GetKey (from), true);
+                    }
+                  else
+                    {
+                      m_cfPollable.Erase (MacAddressHashMap<bool>::GetKey (from));
+                    }
+                  // like the station manager, consider the station
+                  // not associated until the response is acknowledged
+                  m_associations->Disassociate (from);
                   m_stationManager->RecordWaitAssocTxOk (from);
                   // send assoc response with success status.
-                  SendAssocResp (hdr->GetAddr2 (), true);
+                  SendAssocResp (hdr->GetAddr2 (), true, false);
                 }
               return;
             }
           else if (hdr->IsDisassociation ())
             {
               m_stationManager->RecordDisassociated (from);
+              m_associations->Disassociate (from);
+              m_cfPollable.Erase (MacAddressHashMap<bool>::GetKey (from));
+              ReleaseBackoffSlot (from);
               return;
             }
         }
@@ -652,6 +1215,13 @@ ApWifiMac::DeaggregateAmsduAndForward (Ptr<Packet> aggregatedPacket,
           Mac48Address from = (*i).second.GetSourceAddr ();
           Mac48Address to = (*i).second.GetDestinationAddr ();
           NS_LOG_DEBUG ("forwarding QoS frame from=" << from << ", to=" << to);
+          if (m_directIntraBssRelay
+              && !to.IsGroup ()
+              && m_associations->IsAssociated (to)
+              && RelayInBss ((*i).first, hdr, from, to))
+            {
+              continue;
+            }
           ForwardDown ((*i).first, from, to, hdr->GetQosTid ());
         }
     }
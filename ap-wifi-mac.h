@@ -26,7 +26,11 @@
 #include "ht-capabilities.h"
 #include "amsdu-subframe-header.h"
 #include "supported-rates.h"
+#include "mac-address-hash-map.h"
+#include "association-table.h"
 #include "ns3/random-variable-stream.h"
+#include <list>
+#include <vector>
 
 namespace ns3 {
 
@@ -83,6 +87,14 @@ public:
    * \param address the current address of this MAC layer.
    */
   virtual void SetAddress (Mac48Address address);
+  /**
+   * \param ssid the current SSID of this MAC layer.
+   */
+  virtual void SetSsid (Ssid ssid);
+  /**
+   * \param phy the physical layer attached to this MAC.
+   */
+  virtual void SetWifiPhy (Ptr<WifiPhy> phy);
   /**
    * \param interval the interval between two beacon transmissions.
    */
@@ -95,6 +107,24 @@ public:
    * Start beacon transmission immediately.
    */
   void StartBeaconing (void);
+  /**
+   * \return the table of the stations associated with this AP, indexed
+   *         by AID, which per-station statistics can share
+   */
+  Ptr<AssociationTable> GetAssociationTable (void) const;
+  /**
+   * Record that a station wants the frames sent to a multicast group,
+   * for the multicast to unicast conversion.
+   *
+   * \param group the multicast address of the group
+   * \param station the address of the station
+   */
+  void AddMulticastMember (Mac48Address group, Mac48Address station);
+  /**
+   * \param group the multicast address of the group
+   * \param station the address of a station which left the group
+   */
+  void RemoveMulticastMember (Mac48Address group, Mac48Address station);
 
  /**
   * Assign a fixed random variable stream number to the random variables
@@ -157,6 +187,34 @@ private:
    * \param tid the traffic id for the packet
    */
   void ForwardDown (Ptr<const Packet> packet, Mac48Address from, Mac48Address to, uint8_t tid);
+  /**
+   * Forward a unicast copy of a group addressed packet to each member
+   * of the group, other than its source, if the group has at most
+   * MulticastToUnicastThreshold members. The members of the broadcast
+   * group are the associated stations, those of the other groups the
+   * associated stations added by AddMulticastMember.
+   *
+   * \param packet the group addressed packet
+   * \param from the source of the packet
+   * \param to the group address
+   * \param tid the traffic id for the packet
+   * \return true if the packet was converted, false if it must be sent
+   *         to the group address
+   */
+  bool ForwardDownAsUnicast (Ptr<const Packet> packet, Mac48Address from, Mac48Address to, uint8_t tid);
+  /**
+   * Queue a data frame received from a station of our BSS for another
+   * one, reusing the received packet and header: only the addresses
+   * and the per-hop fields are rewritten.
+   *
+   * \param packet the received packet, without its MAC header
+   * \param hdr the received MAC header
+   * \param from the source of the frame
+   * \param to the destination of the frame, an associated station
+   * \return false if the frame was not queued because it must be sent
+   *         with a different frame type
+   */
+  bool RelayInBss (Ptr<const Packet> packet, const WifiMacHeader *hdr, Mac48Address from, Mac48Address to);
   /**
    * Forward a probe response packet to the DCF. The standard is not clear on the correct
    * queue for management frames if QoS is supported. We always use the DCF.
@@ -170,12 +228,89 @@ private:
    *
    * \param to the address of the STA we are sending an association response to
    * \param success indicates whether the association was successful or not
+   * \param redirect whether to point the STA to the SteeringTarget, if
+   *        the association was refused
    */
-  void SendAssocResp (Mac48Address to, bool success);
+  void SendAssocResp (Mac48Address to, bool success, bool redirect);
+  /**
+   * Compute the channel utilization advertised in the BSS load element
+   * from the busy time of the medium since the last call.
+   */
+  void UpdateChannelUtilization (void);
+  /**
+   * Append the BSS load element to a beacon or probe response.
+   *
+   * \param packet the beacon or probe response, without MAC header
+   */
+  void AddBssLoad (Ptr<Packet> packet) const;
+  /**
+   * Give a backoff slot to a station, the least used one so that the
+   * slots are distinct as long as there are fewer stations than slots.
+   *
+   * \param address the address of the station
+   * \return the backoff slot of the station
+   */
+  uint16_t AssignBackoffSlot (Mac48Address address);
+  /**
+   * Take back the backoff slot of a station, if it had one.
+   *
+   * \param address the address of the station
+   */
+  void ReleaseBackoffSlot (Mac48Address address);
   /**
    * Forward a beacon packet to the beacon special DCF.
    */
   void SendOneBeacon (void);
+  /**
+   * Serialize the beacon and probe response templates again if they
+   * were invalidated, or if the HT support or the basic modes, which
+   * are configured outside of this class, changed since they were
+   * serialized.
+   */
+  void UpdateTemplates (void);
+  /**
+   * Throw away the beacon and probe response templates, so that they
+   * are serialized again before the next transmission.
+   */
+  void InvalidateTemplates (void);
+  /**
+   * The packet is built from the bytes of the template, so it carries
+   * no header metadata: the receiver deserializes the management
+   * header from these bytes as usual.
+   *
+   * \param tmpl a serialized beacon or probe response body
+   * \return a packet holding a copy of the template, whose timestamp
+   *         is patched with the current time
+   */
+  Ptr<Packet> CopyTemplate (const std::vector<uint8_t> &tmpl) const;
+  /**
+   * Start a contention-free period, in which the stations which asked
+   * for it are polled in the order of the downlink scheduler.
+   */
+  void StartCfp (void);
+  /**
+   * Forward a CF-Poll for the next station to poll to the beacon special
+   * DCF, or end the contention-free period if there is none left or if
+   * it lasted long enough.
+   */
+  void SendNextCfPoll (void);
+  /**
+   * End the contention-free period with a broadcast CF-Poll, which
+   * resets the NAV of our stations.
+   */
+  void EndCfp (void);
+  /**
+   * The transmission of a CF-Poll is over: give the polled station a
+   * PIFS to start answering.
+   *
+   * \param hdr the header of the CF-Poll
+   */
+  void CfPollSent (const WifiMacHeader &hdr);
+  /**
+   * The polled station did not start answering in time, or its answer
+   * was lost.
+   */
+  void CfPollTimeout (void);
   /**
    * Return the HT capability of the current AP.
    * 
@@ -201,6 +336,7 @@ private:
    * \return true if beacons are periodically generated, false otherwise
    */
   bool GetBeaconGeneration (void) const;
+  virtual void FinishConfigureStandard (enum WifiPhyStandard standard);
   virtual void DoDispose (void);
   virtual void DoInitialize (void);
 
@@ -210,6 +346,37 @@ private:
   EventId m_beaconEvent; //!< Event to generate one beacon
   Ptr<UniformRandomVariable> m_beaconJitter; //!< UniformRandomVariable used to randomize the time of the first beacon
   bool m_enableBeaconJitter; //!< Flag if the first beacon should be generated at random time
+  uint8_t m_uplinkGroups; //!< Number of STA groups sharing the uplink access windows
+  Time m_uplinkWindow; //!< Duration of the uplink access window of each group
+  uint32_t m_cfpInterval; //!< Number of beacons between two contention-free periods, 0 if none
+  Time m_cfpMaxDuration; //!< Maximum duration of a contention-free period
+  uint32_t m_beaconCount; //!< Number of beacons sent since the last contention-free period
+  bool m_cfp; //!< Flag if a contention-free period is in progress
+  Time m_cfpEnd; //!< End of the current contention-free period
+  std::list<Mac48Address> m_cfPollList; //!< Stations left to poll in the current period
+  Mac48Address m_cfPolled; //!< Station polled last
+  EventId m_cfPollTimeoutEvent; //!< Event to give up waiting for the answer to a CF-Poll
+  MacAddressHashMap<bool> m_cfPollable; //!< Stations which asked to be polled
+  uint16_t m_backoffCycleLength; //!< Number of backoff slots to assign, 0 if none
+  MacAddressHashMap<uint16_t> m_backoffSlots; //!< Backoff slot of each station
+  std::vector<uint32_t> m_backoffSlotUsers; //!< Number of stations using each backoff slot
+  Ptr<AssociationTable> m_associations; //!< Associated stations, indexed by AID
+  uint32_t m_multicastToUnicastThreshold; //!< Largest group whose frames are converted to unicast, 0 if none
+  MacAddressHashMap<std::list<Mac48Address> > m_multicastMembers; //!< Members of each multicast group
+  bool m_advertiseBssLoad; //!< Flag if beacons and probe responses carry the BSS load element
+  uint8_t m_channelUtilization; //!< Channel utilization measured over the last beacon interval, out of 255
+  Time m_lastBusyTime; //!< Busy time of the medium at the last utilization update
+  Time m_lastUtilizationUpdate; //!< Time of the last utilization update
+  uint32_t m_maxStations; //!< Number of stations above which association requests are refused, 0 if none
+  Mac48Address m_steeringTarget; //!< BSSID to which refused STAs are redirected, if any
+  std::vector<uint8_t> m_beaconTemplate; //!< Serialized beacon body, whose timestamp is patched at each transmission
+  std::vector<uint8_t> m_probeRespTemplate; //!< Serialized probe response body, whose timestamp is patched at each transmission
+  SupportedRates m_templateRates; //!< Supported rates of the templates, also sent in the association responses
+  HtCapabilities m_templateHtCapabilities; //!< HT capabilities of the templates, also sent in the association responses
+  bool m_templatesValid; //!< Flag if the templates are up to date
+  bool m_templateHtSupported; //!< HT support when the templates were serialized
+  std::vector<WifiMode> m_templateBasicModes; //!< Basic modes when the templates were serialized
+  bool m_directIntraBssRelay; //!< Flag if frames between stations of the BSS are relayed without going up
 };
 
 } // namespace ns3
@@ -0,0 +1,141 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "association-table.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <functional>
+
+NS_LOG_COMPONENT_DEFINE ("AssociationTable");
+
+namespace ns3 {
+
+AssociationTable::AssociationTable (uint16_t maxAid)
+  : m_maxAid (maxAid),
+    m_addresses (1),
+    m_used (1, true),
+    m_generation (0)
+{
+  NS_LOG_FUNCTION (this << maxAid);
+}
+
+uint16_t
+AssociationTable::Associate (Mac48Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+  uint64_t key = MacAddressHashMap<uint16_t>::GetKey (address);
+  uint16_t *existing = m_aids.Find (key);
+  if (existing != 0)
+    {
+      return *existing;
+    }
+  uint16_t aid;
+  if (!m_free.empty ())
+    {
+      std::pop_heap (m_free.begin (), m_free.end (), std::greater<uint16_t> ());
+      aid = m_free.back ();
+      m_free.pop_back ();
+    }
+  else if (m_addresses.size () <= m_maxAid)
+    {
+      aid = m_addresses.size ();
+      m_addresses.push_back (Mac48Address ());
+      m_used.push_back (false);
+    }
+  else
+    {
+      NS_LOG_DEBUG ("no AID left for " << address);
+      return 0;
+    }
+  m_addresses[aid] = address;
+  m_used[aid] = true;
+  m_aids.Insert (key, aid);
+  m_generation++;
+  NS_LOG_DEBUG ("sta=" << address << " aid=" << aid);
+  return aid;
+}
+
+void
+AssociationTable::Disassociate (Mac48Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+  uint64_t key = MacAddressHashMap<uint16_t>::GetKey (address);
+  uint16_t *aid = m_aids.Find (key);
+  if (aid == 0)
+    {
+      return;
+    }
+  m_used[*aid] = false;
+  m_free.push_back (*aid);
+  std::push_heap (m_free.begin (), m_free.end (), std::greater<uint16_t> ());
+  m_aids.Erase (key);
+  m_generation++;
+}
+
+uint16_t
+AssociationTable::GetAid (Mac48Address address) const
+{
+  uint16_t *aid = m_aids.Find (MacAddressHashMap<uint16_t>::GetKey (address));
+  return aid != 0 ? *aid : 0;
+}
+
+bool
+AssociationTable::IsAssociated (Mac48Address address) const
+{
+  return GetAid (address) != 0;
+}
+
+Mac48Address
+AssociationTable::GetAddress (uint16_t aid) const
+{
+  NS_ASSERT (aid < m_used.size () && aid != 0 && m_used[aid]);
+  return m_addresses[aid];
+}
+
+uint32_t
+AssociationTable::GetAidBound (void) const
+{
+  return m_addresses.size ();
+}
+
+uint32_t
+AssociationTable::GetNStations (void) const
+{
+  return m_aids.GetSize ();
+}
+
+std::list<Mac48Address>
+AssociationTable::GetStations (void) const
+{
+  std::list<Mac48Address> stations;
+  for (uint32_t aid = 1; aid < m_addresses.size (); aid++)
+    {
+      if (m_used[aid])
+        {
+          stations.push_back (m_addresses[aid]);
+        }
+    }
+  return stations;
+}
+
+uint32_t
+AssociationTable::GetGeneration (void) const
+{
+  return m_generation;
+}
+
+} // namespace ns3
@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef ASSOCIATION_TABLE_H
+#define ASSOCIATION_TABLE_H
+
+#include <stdint.h>
+#include <vector>
+#include <list>
+#include "ns3/simple-ref-count.h"
+#include "ns3/mac48-address.h"
+#include "mac-address-hash-map.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ * \brief the stations associated with an AP, indexed by association ID
+ *
+ * Each associated station gets the lowest free association ID (AID),
+ * from 1 to the maximum AID, so that the AIDs stay dense and can index
+ * plain arrays: the users of the table keep their per-station state in
+ * vectors indexed by AID and find the AID of a frame's address with a
+ * single hash lookup. An AID is given back when its station
+ * disassociates and may then be given to another station, so per-AID
+ * state should remember the address it belongs to.
+ */
+class AssociationTable : public SimpleRefCount<AssociationTable>
+{
+public:
+  /**
+   * \param maxAid the highest AID to give, 2007 in IEEE 802.11
+   */
+  AssociationTable (uint16_t maxAid = 2007);
+
+  /**
+   * \param address the address of a station
+   * \return the AID of the station, which keeps its AID if it was
+   *         already associated, or 0 if all the AIDs are taken
+   */
+  uint16_t Associate (Mac48Address address);
+  /**
+   * \param address the address of a station, which gives its AID back
+   *        if it was associated
+   */
+  void Disassociate (Mac48Address address);
+  /**
+   * \param address the address of a station
+   * \return the AID of the station, 0 if it is not associated
+   */
+  uint16_t GetAid (Mac48Address address) const;
+  /**
+   * \param address the address of a station
+   * \return true if the station is associated
+   */
+  bool IsAssociated (Mac48Address address) const;
+  /**
+   * \param aid an AID
+   * \return the address of the station with this AID, which must be in use
+   */
+  Mac48Address GetAddress (uint16_t aid) const;
+  /**
+   * \return one more than the highest AID ever given, i.e. the size of
+   *         an array indexed by AID
+   */
+  uint32_t GetAidBound (void) const;
+  /**
+   * \return the number of associated stations
+   */
+  uint32_t GetNStations (void) const;
+  /**
+   * \return the addresses of the associated stations, by increasing AID
+   */
+  std::list<Mac48Address> GetStations (void) const;
+  /**
+   * \return a counter incremented each time a station associates or
+   *         disassociates, so that the users of the table know when to
+   *         rebuild the state they derived from it
+   */
+  uint32_t GetGeneration (void) const;
+
+private:
+  AssociationTable (const AssociationTable &o);
+  AssociationTable & operator = (const AssociationTable &o);
+
+  uint16_t m_maxAid;
+  MacAddressHashMap<uint16_t> m_aids; //!< AID of each associated station
+  std::vector<Mac48Address> m_addresses; //!< address of each AID, AID 0 unused
+  std::vector<bool> m_used; //!< whether each AID is in use
+  std::vector<uint16_t> m_free; //!< AIDs given back, as a min-heap
+  uint32_t m_generation;
+};
+
+} // namespace ns3
+
+#endif /* ASSOCIATION_TABLE_H */
@@ -0,0 +1,80 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "bss-color-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (BssColorTag)
+  ;
+
+TypeId
+BssColorTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BssColorTag")
+    .SetParent<Tag> ()
+    .AddConstructor<BssColorTag> ()
+  ;
+  return tid;
+}
+TypeId
+BssColorTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+BssColorTag::BssColorTag ()
+  : m_color (0)
+{
+}
+BssColorTag::BssColorTag (uint8_t color)
+  : m_color (color)
+{
+}
+
+uint32_t
+BssColorTag::GetSerializedSize (void) const
+{
+  return sizeof (uint8_t);
+}
+void
+BssColorTag::Serialize (TagBuffer i) const
+{
+  i.WriteU8 (m_color);
+}
+void
+BssColorTag::Deserialize (TagBuffer i)
+{
+  m_color = i.ReadU8 ();
+}
+void
+BssColorTag::Print (std::ostream &os) const
+{
+  os << "Color=" << (uint32_t) m_color;
+}
+
+void
+BssColorTag::Set (uint8_t color)
+{
+  m_color = color;
+}
+uint8_t
+BssColorTag::Get (void) const
+{
+  return m_color;
+}
+
+} // namespace ns3
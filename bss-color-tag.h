@@ -0,0 +1,64 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BSS_COLOR_TAG_H
+#define BSS_COLOR_TAG_H
+
+#include "ns3/tag.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ *
+ * The color of the BSS which sent a frame. MacLow puts it on every
+ * frame it sends once its BSS has a color, the way an 802.11ax PHY
+ * header carries it, so that the receivers can tell as soon as the
+ * reception starts whether the frame comes from their own BSS or from
+ * an overlapping one.
+ */
+class BssColorTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  BssColorTag ();
+  /**
+   * \param color the BSS color, from 1 to 63
+   */
+  BssColorTag (uint8_t color);
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * \param color the BSS color, from 1 to 63
+   */
+  void Set (uint8_t color);
+  /**
+   * \return the BSS color
+   */
+  uint8_t Get (void) const;
+
+private:
+  uint8_t m_color;
+};
+
+} // namespace ns3
+
+#endif /* BSS_COLOR_TAG_H */
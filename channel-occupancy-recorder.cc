@@ -0,0 +1,381 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "channel-occupancy-recorder.h"
+#include "wifi-net-device.h"
+#include "regular-wifi-mac.h"
+#include "wifi-phy.h"
+#include "wifi-mac-header.h"
+#include "dcf.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/pointer.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include <iomanip>
+
+NS_LOG_COMPONENT_DEFINE ("ChannelOccupancyRecorder");
+
+namespace ns3 {
+
+/***********************************************************
+ *          Timeline of a node
+ ***********************************************************/
+
+ChannelOccupancyRecorder::Timeline::Timeline (ChannelOccupancyRecorder *recorder, uint32_t node)
+  : m_recorder (recorder),
+    m_node (node),
+    m_txName ("tx")
+{
+  for (uint32_t i = 0; i < DcfManager::BUSY_TYPES; i++)
+    {
+      m_open[i] = false;
+      m_start[i] = Seconds (0.0);
+      m_end[i] = Seconds (0.0);
+    }
+  m_name[DcfManager::BUSY_RX] = "rx";
+  m_name[DcfManager::BUSY_TX] = "tx";
+  m_name[DcfManager::BUSY_NAV] = "nav";
+  m_name[DcfManager::BUSY_CCA] = "cca";
+}
+
+void
+ChannelOccupancyRecorder::Timeline::NotifyMediumBusy (enum DcfManager::BusyType type, Time duration)
+{
+  Time now = Simulator::Now ();
+  if (duration.IsZero ())
+    {
+      // the busy period ended early
+      CloseBusyPeriod (type, now);
+      m_end[type] = Min (m_end[type], now);
+      return;
+    }
+  Time busyUntil = m_end[0];
+  for (uint32_t i = 1; i < DcfManager::BUSY_TYPES; i++)
+    {
+      busyUntil = Max (busyUntil, m_end[i]);
+    }
+  if (now > busyUntil)
+    {
+      m_recorder->WriteEvent (m_node, TRACK_IDLE, "idle", busyUntil, now);
+    }
+  CloseBusyPeriod (type, now);
+  m_open[type] = true;
+  m_start[type] = now;
+  m_end[type] = now + duration;
+  switch (type)
+    {
+    case DcfManager::BUSY_RX:
+      m_name[type] = "rx";
+      break;
+    case DcfManager::BUSY_TX:
+      m_name[type] = m_txName;
+      break;
+    default:
+      break;
+    }
+}
+
+void
+ChannelOccupancyRecorder::Timeline::NotifyTxBegin (Ptr<const Packet> packet)
+{
+  WifiMacHeader hdr;
+  if (packet->PeekHeader (hdr) != 0)
+    {
+      m_txName = hdr.GetTypeString ();
+    }
+}
+
+void
+ChannelOccupancyRecorder::Timeline::NotifyRxEnd (Ptr<const Packet> packet)
+{
+  // only name the busy period which ends with this frame
+  if (!m_open[DcfManager::BUSY_RX]
+      || m_end[DcfManager::BUSY_RX] != Simulator::Now ())
+    {
+      return;
+    }
+  WifiMacHeader hdr;
+  if (packet->PeekHeader (hdr) != 0)
+    {
+      m_name[DcfManager::BUSY_RX] = std::string ("rx ") + hdr.GetTypeString ();
+    }
+}
+
+void
+ChannelOccupancyRecorder::Timeline::NotifyRxDrop (Ptr<const Packet> packet)
+{
+  if (m_open[DcfManager::BUSY_RX]
+      && m_end[DcfManager::BUSY_RX] == Simulator::Now ())
+    {
+      m_name[DcfManager::BUSY_RX] = "rx error";
+    }
+}
+
+void
+ChannelOccupancyRecorder::Timeline::Close (void)
+{
+  Time now = Simulator::Now ();
+  Time busyUntil = m_end[0];
+  for (uint32_t i = 0; i < DcfManager::BUSY_TYPES; i++)
+    {
+      CloseBusyPeriod (static_cast<enum DcfManager::BusyType> (i), now);
+      busyUntil = Max (busyUntil, m_end[i]);
+    }
+  if (now > busyUntil)
+    {
+      m_recorder->WriteEvent (m_node, TRACK_IDLE, "idle", busyUntil, now);
+    }
+}
+
+void
+ChannelOccupancyRecorder::Timeline::CloseBusyPeriod (enum DcfManager::BusyType type, Time end)
+{
+  if (!m_open[type])
+    {
+      return;
+    }
+  uint32_t track;
+  switch (type)
+    {
+    case DcfManager::BUSY_RX:
+      track = TRACK_RX;
+      break;
+    case DcfManager::BUSY_TX:
+      track = TRACK_TX;
+      break;
+    case DcfManager::BUSY_NAV:
+      track = TRACK_NAV;
+      break;
+    default:
+      track = TRACK_CCA;
+      break;
+    }
+  m_recorder->WriteEvent (m_node, track, m_name[type],
+                          m_start[type], Min (m_end[type], end));
+  m_open[type] = false;
+}
+
+/***********************************************************
+ *          Access periods of a DCF
+ ***********************************************************/
+
+ChannelOccupancyRecorder::AccessTrack::AccessTrack (ChannelOccupancyRecorder *recorder,
+                                                    uint32_t node, uint32_t track)
+  : m_recorder (recorder),
+    m_node (node),
+    m_track (track)
+{
+}
+
+void
+ChannelOccupancyRecorder::AccessTrack::NotifyAccessDelay (Time delay)
+{
+  Time now = Simulator::Now ();
+  m_recorder->WriteEvent (m_node, m_track, "access", now - delay, now);
+}
+
+/***********************************************************
+ *          Recorder
+ ***********************************************************/
+
+NS_OBJECT_ENSURE_REGISTERED (ChannelOccupancyRecorder)
+  ;
+
+TypeId
+ChannelOccupancyRecorder::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ChannelOccupancyRecorder")
+    .SetParent<Object> ()
+    .AddConstructor<ChannelOccupancyRecorder> ()
+    .AddAttribute ("FileName", "The name of the trace event (JSON) file to write.",
+                   StringValue ("channel-occupancy.json"),
+                   MakeStringAccessor (&ChannelOccupancyRecorder::m_fileName),
+                   MakeStringChecker ())
+    .AddAttribute ("StartTime", "The start of the recording window.",
+                   TimeValue (Seconds (0.0)),
+                   MakeTimeAccessor (&ChannelOccupancyRecorder::m_startTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("StopTime", "The end of the recording window. Keep the window short: "
+                   "a busy node writes several events per frame.",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&ChannelOccupancyRecorder::m_stopTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("BufferSize", "The number of bytes of events buffered before they are written to the file.",
+                   UintegerValue (65536),
+                   MakeUintegerAccessor (&ChannelOccupancyRecorder::m_bufferSize),
+                   MakeUintegerChecker<uint32_t> ())
+  ;
+  return tid;
+}
+
+ChannelOccupancyRecorder::ChannelOccupancyRecorder ()
+  : m_empty (true),
+    m_closed (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+ChannelOccupancyRecorder::~ChannelOccupancyRecorder ()
+{
+  NS_LOG_FUNCTION (this);
+  Close ();
+}
+
+void
+ChannelOccupancyRecorder::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Close ();
+  Object::DoDispose ();
+}
+
+void
+ChannelOccupancyRecorder::Attach (Ptr<WifiNetDevice> device)
+{
+  NS_LOG_FUNCTION (this << device);
+  Ptr<RegularWifiMac> mac = DynamicCast<RegularWifiMac> (device->GetMac ());
+  NS_ASSERT_MSG (mac != 0, "ChannelOccupancyRecorder needs a RegularWifiMac");
+  if (!m_file.is_open ())
+    {
+      m_file.open (m_fileName.c_str ());
+      m_file << "[";
+      // keep the recorder alive until the end of the simulation
+      Simulator::ScheduleDestroy (&ChannelOccupancyRecorder::Close,
+                                  Ptr<ChannelOccupancyRecorder> (this));
+    }
+  uint32_t node = device->GetNode ()->GetId ();
+
+  m_timelines.push_back (Timeline (this, node));
+  Timeline *timeline = &m_timelines.back ();
+  mac->TraceConnectWithoutContext ("MediumBusy",
+                                   MakeCallback (&Timeline::NotifyMediumBusy, timeline));
+  Ptr<WifiPhy> phy = device->GetPhy ();
+  phy->TraceConnectWithoutContext ("PhyTxBegin", MakeCallback (&Timeline::NotifyTxBegin, timeline));
+  phy->TraceConnectWithoutContext ("PhyRxEnd", MakeCallback (&Timeline::NotifyRxEnd, timeline));
+  phy->TraceConnectWithoutContext ("PhyRxDrop", MakeCallback (&Timeline::NotifyRxDrop, timeline));
+
+  std::ostringstream os;
+  os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << node
+     << ",\"args\":{\"name\":\"node " << node << "\"}}";
+  Append (os.str ());
+  WriteTrackName (node, TRACK_TX, "tx");
+  WriteTrackName (node, TRACK_RX, "rx");
+  WriteTrackName (node, TRACK_NAV, "nav");
+  WriteTrackName (node, TRACK_CCA, "cca");
+  WriteTrackName (node, TRACK_IDLE, "idle");
+
+  static const char *dcfs[] = { "DcaTxop", "VO_EdcaTxopN", "VI_EdcaTxopN", "BE_EdcaTxopN", "BK_EdcaTxopN" };
+  for (uint32_t i = 0; i < sizeof (dcfs) / sizeof (dcfs[0]); i++)
+    {
+      PointerValue ptr;
+      mac->GetAttribute (dcfs[i], ptr);
+      Ptr<Dcf> dcf = ptr.Get<Dcf> ();
+      if (dcf == 0)
+        {
+          continue;
+        }
+      m_accessTracks.push_back (AccessTrack (this, node, TRACK_ACCESS + i));
+      dcf->TraceConnectWithoutContext ("AccessDelay",
+                                       MakeCallback (&AccessTrack::NotifyAccessDelay, &m_accessTracks.back ()));
+      WriteTrackName (node, TRACK_ACCESS + i, std::string ("access ") + dcfs[i]);
+    }
+}
+
+void
+ChannelOccupancyRecorder::WriteTrackName (uint32_t node, uint32_t track, const std::string &name)
+{
+  std::ostringstream os;
+  os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << node << ",\"tid\":" << track
+     << ",\"args\":{\"name\":\"" << name << "\"}}";
+  Append (os.str ());
+}
+
+void
+ChannelOccupancyRecorder::WriteEvent (uint32_t node, uint32_t track, const std::string &name,
+                                      Time start, Time end)
+{
+  if (m_closed)
+    {
+      return;
+    }
+  start = Max (start, m_startTime);
+  end = Min (end, m_stopTime);
+  if (end <= start)
+    {
+      return;
+    }
+  std::ostringstream os;
+  os << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":" << node << ",\"tid\":" << track
+     << ",\"ts\":" << FormatTime (start) << ",\"dur\":" << FormatTime (end - start) << "}";
+  Append (os.str ());
+}
+
+void
+ChannelOccupancyRecorder::Append (const std::string &event)
+{
+  if (!m_empty)
+    {
+      m_buffer << ",";
+    }
+  m_empty = false;
+  m_buffer << "\n" << event;
+  if (static_cast<uint32_t> (m_buffer.tellp ()) >= m_bufferSize)
+    {
+      Flush ();
+    }
+}
+
+std::string
+ChannelOccupancyRecorder::FormatTime (Time t)
+{
+  int64_t ns = t.GetNanoSeconds ();
+  std::ostringstream os;
+  os << ns / 1000 << "." << std::setw (3) << std::setfill ('0') << ns % 1000;
+  return os.str ();
+}
+
+void
+ChannelOccupancyRecorder::Flush (void)
+{
+  m_file << m_buffer.str ();
+  m_buffer.str ("");
+}
+
+void
+ChannelOccupancyRecorder::Close (void)
+{
+  if (m_closed)
+    {
+      return;
+    }
+  NS_LOG_FUNCTION (this);
+  for (std::list<Timeline>::iterator i = m_timelines.begin (); i != m_timelines.end (); i++)
+    {
+      i->Close ();
+    }
+  m_closed = true;
+  if (m_file.is_open ())
+    {
+      Flush ();
+      m_file << "\n]\n";
+      m_file.close ();
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,183 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef CHANNEL_OCCUPANCY_RECORDER_H
+#define CHANNEL_OCCUPANCY_RECORDER_H
+
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <fstream>
+#include <sstream>
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "dcf-manager.h"
+
+namespace ns3 {
+
+class WifiNetDevice;
+
+/**
+ * \ingroup wifi
+ *
+ * Records how each node sees the channel and writes it as a timeline in
+ * the JSON trace event format of Chrome (chrome://tracing) and Perfetto:
+ * one process per node, with one track for each of the TX, RX, NAV and
+ * CCA busy periods reported by its DcfManager, one for the idle periods
+ * in between, and one for the access periods (from the access request
+ * to the access grant, i.e. deferral and backoff) of each of its DCFs.
+ * The transmitted and received frames are named after their type.
+ *
+ * Only the nodes of the devices passed to Attach are recorded, and only
+ * between the StartTime and StopTime attributes. The events are
+ * buffered and written to the file as the simulation goes, so the
+ * recorder must live until the end of the simulation.
+ */
+class ChannelOccupancyRecorder : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ChannelOccupancyRecorder ();
+  virtual ~ChannelOccupancyRecorder ();
+
+  /**
+   * Record the timeline of the node of a device.
+   *
+   * \param device the device, which must use a RegularWifiMac
+   */
+  void Attach (Ptr<WifiNetDevice> device);
+
+private:
+  virtual void DoDispose (void);
+
+  /**
+   * The tracks of the timeline of a node.
+   */
+  enum Track
+  {
+    TRACK_TX = 1,
+    TRACK_RX,
+    TRACK_NAV,
+    TRACK_CCA,
+    TRACK_IDLE,
+    TRACK_ACCESS
+  };
+
+  /**
+   * The state of the timeline of a node.
+   */
+  class Timeline
+  {
+  public:
+    Timeline (ChannelOccupancyRecorder *recorder, uint32_t node);
+
+    void NotifyMediumBusy (enum DcfManager::BusyType type, Time duration);
+    void NotifyTxBegin (Ptr<const Packet> packet);
+    void NotifyRxEnd (Ptr<const Packet> packet);
+    void NotifyRxDrop (Ptr<const Packet> packet);
+    /**
+     * Write the busy periods which are still open.
+     */
+    void Close (void);
+
+  private:
+    /**
+     * \param type a cause of busy medium
+     * \param end the end of the busy period of this cause
+     *
+     * Write the busy period of this cause, up to end at most.
+     */
+    void CloseBusyPeriod (enum DcfManager::BusyType type, Time end);
+
+    ChannelOccupancyRecorder *m_recorder;
+    uint32_t m_node;
+    bool m_open[DcfManager::BUSY_TYPES]; //!< whether a busy period of this cause is open
+    Time m_start[DcfManager::BUSY_TYPES]; //!< start of the busy period of this cause
+    Time m_end[DcfManager::BUSY_TYPES]; //!< (expected) end of the last busy period of this cause
+    std::string m_name[DcfManager::BUSY_TYPES]; //!< name of the busy period of this cause
+    std::string m_txName; //!< type of the frame being transmitted
+  };
+
+  /**
+   * The access track of a DCF.
+   */
+  class AccessTrack
+  {
+  public:
+    AccessTrack (ChannelOccupancyRecorder *recorder, uint32_t node, uint32_t track);
+
+    void NotifyAccessDelay (Time delay);
+
+  private:
+    ChannelOccupancyRecorder *m_recorder;
+    uint32_t m_node;
+    uint32_t m_track;
+  };
+
+  friend class Timeline;
+  friend class AccessTrack;
+
+  /**
+   * \param node the node of the track
+   * \param track the track
+   * \param name the name of the track
+   */
+  void WriteTrackName (uint32_t node, uint32_t track, const std::string &name);
+  /**
+   * Write an event of the timeline, clipped to the recording window.
+   *
+   * \param node the node of the event
+   * \param track the track of the event
+   * \param name the name of the event
+   * \param start the start of the event
+   * \param end the end of the event
+   */
+  void WriteEvent (uint32_t node, uint32_t track, const std::string &name, Time start, Time end);
+  /**
+   * \param event the JSON object to append to the trace
+   */
+  void Append (const std::string &event);
+  /**
+   * \param t a time
+   * \return t in microseconds, as the trace event format wants it
+   */
+  static std::string FormatTime (Time t);
+  /**
+   * Write the buffered events to the file.
+   */
+  void Flush (void);
+  /**
+   * Write the open busy periods and terminate the file.
+   */
+  void Close (void);
+
+  std::string m_fileName;
+  Time m_startTime;
+  Time m_stopTime;
+  uint32_t m_bufferSize;
+
+  std::ofstream m_file;
+  std::ostringstream m_buffer;
+  bool m_empty; //!< whether no event has been written yet
+  bool m_closed;
+  std::list<Timeline> m_timelines;
+  std::list<AccessTrack> m_accessTracks;
+};
+
+} // namespace ns3
+
+#endif /* CHANNEL_OCCUPANCY_RECORDER_H */
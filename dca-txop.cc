@@ -26,6 +26,9 @@
 #include "ns3/uinteger.h"
 #include "ns3/pointer.h"
 #include "ns3/nstime.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
 
 #include "dca-txop.h"
 #include "dcf-manager.h"
@@ -37,6 +40,7 @@
 #include "random-stream.h"
 
 #include <vector>
+#include <algorithm>
 
 NS_LOG_COMPONENT_DEFINE ("DcaTxop");
 
@@ -55,14 +59,17 @@ public:
 private:
   virtual void DoNotifyAccessGranted (void)
   {
+    m_txop->m_accessDelayTrace (GetLastAccessDelay ());
     m_txop->NotifyAccessGranted ();
   }
   virtual void DoNotifyInternalCollision (void)
   {
+    m_txop->m_collisionTrace (true);
     m_txop->NotifyInternalCollision ();
   }
   virtual void DoNotifyCollision (void)
   {
+    m_txop->m_collisionTrace (false);
     m_txop->NotifyCollision ();
   }
   virtual void DoNotifyChannelSwitching (void)
@@ -136,24 +143,100 @@ DcaTxop::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&DcaTxop::GetQueue),
                    MakePointerChecker<WifiMacQueue> ())
+    .AddAttribute ("AdaptiveProtection", "If true, enable rts/cts and fragmentation per destination "
+                   "depending on the retry ratio observed towards it.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&DcaTxop::m_adaptiveProtection),
+                   MakeBooleanChecker ())
+    .AddAttribute ("RtsEnableRetryRatio", "The retry ratio above which the protection of a destination is increased.",
+                   DoubleValue (0.3),
+                   MakeDoubleAccessor (&DcaTxop::m_rtsEnableRetryRatio),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("RtsDisableRetryRatio", "The retry ratio below which the protection of a destination is decreased.",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&DcaTxop::m_rtsDisableRetryRatio),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("ProtectionWindow", "The number of transmission attempts over which the retry ratio is measured.",
+                   UintegerValue (20),
+                   MakeUintegerAccessor (&DcaTxop::m_protectionWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("AdaptiveFragmentationThreshold", "The fragmentation threshold used for destinations "
+                   "that still suffer losses with rts/cts. 0 disables adaptive fragmentation, "
+                   "other values are raised to at least 256.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&DcaTxop::DoSetAdaptiveFragmentationThreshold,
+                                         &DcaTxop::DoGetAdaptiveFragmentationThreshold),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("MaxManagementShare", "The share of the airtime above which management frames, "
+                   "which are otherwise sent before data frames, wait for the data and priority queues to be empty.",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&DcaTxop::m_maxManagementShare),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("ManagementShareWindow", "The interval over which the airtime share of management frames is measured.",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&DcaTxop::m_managementShareWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("PriorityThreshold", "The size (bytes) up to which the data frames of a non-AP station, "
+                   "such as TCP ACKs and SYNs, go to a priority band served before the bulk band. "
+                   "0 keeps a single band.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&DcaTxop::m_priorityThreshold),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("MaxPriorityBurst", "The number of frames of the priority band served in a row "
+                   "before a waiting frame of the bulk band is served.",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&DcaTxop::m_maxPriorityBurst),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("HoldOffThreshold", "The number of consecutive failed attempts to a station after which "
+                   "the AP holds back its frames, sending them only when no other station has any; "
+                   "each further run of as many failures doubles the hold-off. 0 disables hold-offs.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&DcaTxop::m_holdOffThreshold),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("HoldOff", "The first hold-off of a failing station.",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&DcaTxop::m_holdOff),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxHoldOff", "The longest hold-off of a failing station.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&DcaTxop::m_maxHoldOff),
+                   MakeTimeChecker ())
+    .AddTraceSource ("MacLatency",
+                     "A packet left the MAC, acknowledged or dropped, with its queue wait, "
+                     "access delay, number of attempts and on-air time.",
+                     MakeTraceSourceAccessor (&DcaTxop::m_macLatencyTrace))
   ;
   return tid;
 }
 
 DcaTxop::DcaTxop ()
   : m_manager (0),
-    m_currentPacket (0)
+    m_activeGeneration (0),
+    m_activeChanged (true),
+    m_currentPacket (0),
+    m_fragmentationThreshold (0),
+    m_accessWindow (false),
+    m_polled (false),
+    m_backoffSlot (0),
+    m_backoffCycle (0),
+    m_priorityThreshold (0),
+    m_maxPriorityBurst (4),
+    m_priorityBurst (0),
+    m_holdOffThreshold (0)
 {
   NS_LOG_FUNCTION (this);
   m_transmissionListener = new DcaTxop::TransmissionListener (this);
   m_dcf = new DcaTxop::Dcf (this);
   m_queue = CreateObject<WifiMacQueue> ();
+  m_managementQueue = CreateObject<WifiMacQueue> ();
+  m_priorityQueue = CreateObject<WifiMacQueue> ();
   m_rng = new RealRandomStream ();
   m_txMiddle = new MacTxMiddle ();
   numClients=30;
   counter=0;
   schedTime =Seconds(0.0);
   schedI=m_clients.begin();
+  m_lastServiceEnd = Seconds (0.0);
 }
 
 DcaTxop::~DcaTxop ()
@@ -166,8 +249,13 @@ DcaTxop::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
   m_queue = 0;
+  m_managementQueue = 0;
+  m_priorityQueue = 0;
+  m_requeuedFrames.clear ();
   m_low = 0;
+  m_associations = 0;
   m_stationManager = 0;
+  m_accessWindowEvent.Cancel ();
   delete m_transmissionListener;
   delete m_dcf;
   delete m_rng;
@@ -254,6 +342,36 @@ DcaTxop::GetAifsn (void) const
   NS_LOG_FUNCTION (this);
   return m_dcf->GetAifsn ();
 }
+void
+DcaTxop::SetIdleSense (bool enable)
+{
+  NS_LOG_FUNCTION (this << enable);
+  m_dcf->SetIdleSense (enable);
+}
+bool
+DcaTxop::GetIdleSense (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_dcf->GetIdleSense ();
+}
+void
+DcaTxop::SetIdleSenseTarget (double target)
+{
+  NS_LOG_FUNCTION (this << target);
+  m_dcf->SetIdleSenseTarget (target);
+}
+double
+DcaTxop::GetIdleSenseTarget (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_dcf->GetIdleSenseTarget ();
+}
+const DcfState *
+DcaTxop::GetDcfState (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_dcf;
+}
 
 void
 DcaTxop::Queue (Ptr<const Packet> packet, const WifiMacHeader &hdr)
@@ -264,25 +382,41 @@ DcaTxop::Queue (Ptr<const Packet> packet, const WifiMacHeader &hdr)
   uint32_t fullPacketSize = hdr.GetSerializedSize () + packet->GetSize () + fcs.GetSerializedSize ();
   m_stationManager->PrepareForQueue (hdr.GetAddr1 (), &hdr,
                                      packet, fullPacketSize);
+  MacLatencyTag latency;
+  latency.SetEnqueueTime (Simulator::Now ());
+  packet->AddPacketTag (latency);
   if(m_low->GetBssid()==m_low->GetAddress()){
-	  bool match=false;
-
-  clientsI it;
-  it=m_clients.begin();
-  for (; it != m_clients.end (); it++){
-	 // std::cout<<"Queue packet at"<<m_low->GetAddress()<<" addr="<<*it<<std::endl;
-  if(*it==hdr.GetAddr1()){
-	  match=true;
-	  break;
-  }
-  }
-  if(it==m_clients.end() && !match && hdr.GetAddr1()!=Mac48Address("ff:ff:ff:ff:ff:ff")){
+  if(hdr.GetAddr1()!=Mac48Address("ff:ff:ff:ff:ff:ff") && !IsClient (hdr.GetAddr1 ())){
 	 // std::cout<<"in list inserted at"<<m_low->GetAddress()<<" addr="<<hdr.GetAddr1()<<std::endl;
-	  m_clients.push_back(hdr.GetAddr1());
-	  match=false;
+	  AddClient (hdr.GetAddr1 ());
   }
   }
-  m_queue->Enqueue (packet, hdr);
+  if (hdr.IsMgt ())
+    {
+      m_managementQueue->Enqueue (packet, hdr);
+    }
+  else if (m_priorityThreshold != 0
+           && packet->GetSize () <= m_priorityThreshold
+           && m_low->GetBssid () != m_low->GetAddress ())
+    {
+      m_priorityQueue->Enqueue (packet, hdr);
+    }
+  else
+    {
+      m_queue->Enqueue (packet, hdr);
+    }
+  StartAccessIfNeeded ();
+}
+
+void
+DcaTxop::QueueUnscheduled (Ptr<const Packet> packet, const WifiMacHeader &hdr)
+{
+  NS_LOG_FUNCTION (this << packet << &hdr);
+  WifiMacTrailer fcs;
+  uint32_t fullPacketSize = hdr.GetSerializedSize () + packet->GetSize () + fcs.GetSerializedSize ();
+  m_stationManager->PrepareForQueue (hdr.GetAddr1 (), &hdr,
+                                     packet, fullPacketSize);
+  m_managementQueue->Enqueue (packet, hdr);
   StartAccessIfNeeded ();
 }
 
@@ -299,8 +433,9 @@ DcaTxop::RestartAccessIfNeeded (void)
 {
   NS_LOG_FUNCTION (this);
   if ((m_currentPacket != 0
-       || !m_queue->IsEmpty ())
-      && !m_dcf->IsAccessRequested ())
+       || !IsQueueEmpty ())
+      && !m_dcf->IsAccessRequested ()
+      && !DeferToAccessWindow ())
     {
       m_manager->RequestAccess (m_dcf);
     }
@@ -311,13 +446,146 @@ DcaTxop::StartAccessIfNeeded (void)
 {
   NS_LOG_FUNCTION (this);
   if (m_currentPacket == 0
-      && !m_queue->IsEmpty ()
-      && !m_dcf->IsAccessRequested ())
+      && !IsQueueEmpty ()
+      && !m_dcf->IsAccessRequested ()
+      && !DeferToAccessWindow ())
     {
       m_manager->RequestAccess (m_dcf);
     }
 }
 
+void
+DcaTxop::SetAccessWindow (Time start, Time duration, Time period)
+{
+  NS_LOG_FUNCTION (this << start << duration << period);
+  NS_ASSERT (duration.IsStrictlyPositive () && period >= duration);
+  m_accessWindow = true;
+  m_accessWindowStart = start;
+  m_accessWindowDuration = duration;
+  m_accessWindowPeriod = period;
+  m_accessWindowEvent.Cancel ();
+  RestartAccessIfNeeded ();
+}
+
+void
+DcaTxop::ClearAccessWindow (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_accessWindow = false;
+  m_accessWindowEvent.Cancel ();
+  RestartAccessIfNeeded ();
+}
+
+void
+DcaTxop::NotifyPolled (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_currentPacket == 0 && IsQueueEmpty ())
+    {
+      NS_LOG_DEBUG ("polled with nothing to send");
+      return;
+    }
+  // the backoff must not be restarted while the polled exchange is in
+  // progress; it is deferred again when it is over if need be
+  m_accessWindowEvent.Cancel ();
+  m_polled = true;
+  m_manager->GrantAccessNow (m_dcf);
+  m_polled = false;
+}
+
+void
+DcaTxop::SetAssociationTable (Ptr<AssociationTable> table)
+{
+  NS_LOG_FUNCTION (this << table);
+  m_associations = table;
+  m_clientByAid.clear ();
+  m_activeByAid.clear ();
+  m_activeChanged = true;
+}
+
+void
+DcaTxop::SetBackoffSlot (uint32_t slot, uint32_t cycle)
+{
+  NS_LOG_FUNCTION (this << slot << cycle);
+  NS_ASSERT (slot < cycle);
+  m_backoffSlot = slot;
+  m_backoffCycle = cycle;
+  if (m_currentPacket == 0
+      && !m_dcf->IsAccessRequested ())
+    {
+      m_dcf->RestartBackoffNow (slot);
+    }
+}
+
+void
+DcaTxop::ClearBackoffSlot (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_backoffCycle = 0;
+}
+
+std::list<Mac48Address>
+DcaTxop::GetSchedulerOrder (void) const
+{
+  std::list<Mac48Address> order = active_clients;
+  std::list<Mac48Address>::const_iterator i = schedI;
+  for (uint32_t n = 0; n < m_clients.size (); n++, i++)
+    {
+      if (i == m_clients.end ())
+        {
+          i = m_clients.begin ();
+        }
+      if (std::find (active_clients.begin (), active_clients.end (), *i) == active_clients.end ())
+        {
+          order.push_back (*i);
+        }
+    }
+  return order;
+}
+
+bool
+DcaTxop::DeferToAccessWindow (void)
+{
+  if (!m_accessWindow || m_polled)
+    {
+      return false;
+    }
+  Time now = Simulator::Now ();
+  Time delay;
+  if (now < m_accessWindowStart)
+    {
+      delay = m_accessWindowStart - now;
+    }
+  else
+    {
+      int64_t offset = (now - m_accessWindowStart).GetTimeStep () % m_accessWindowPeriod.GetTimeStep ();
+      if (offset < m_accessWindowDuration.GetTimeStep ())
+        {
+          return false;
+        }
+      delay = m_accessWindowPeriod - TimeStep (offset);
+    }
+  if (!m_accessWindowEvent.IsRunning ())
+    {
+      NS_LOG_DEBUG ("defer access by " << delay);
+      m_accessWindowEvent = Simulator::Schedule (delay, &DcaTxop::AccessWindowStart, this);
+    }
+  return true;
+}
+
+void
+DcaTxop::AccessWindowStart (void)
+{
+  NS_LOG_FUNCTION (this);
+  if ((m_currentPacket != 0 || !IsQueueEmpty ())
+      && !m_dcf->IsAccessRequested ())
+    {
+      // the stations of the group would all transmit at once otherwise
+      m_dcf->RestartBackoffNow (m_rng->GetNext (0, m_dcf->GetCw ()));
+    }
+  RestartAccessIfNeeded ();
+}
+
 
 Ptr<MacLow>
 DcaTxop::Low (void)
@@ -330,6 +598,14 @@ bool
 DcaTxop::NeedRts (Ptr<const Packet> packet, const WifiMacHeader *header)
 {
   NS_LOG_FUNCTION (this << packet << header);
+  if (m_adaptiveProtection && !header->GetAddr1 ().IsGroup ())
+    {
+      StationProtection *protection = m_protection.Find (StationProtections::GetKey (header->GetAddr1 ()));
+      if (protection != 0 && protection->level >= PROTECTION_RTS)
+        {
+          return true;
+        }
+    }
   return m_stationManager->NeedRts (header->GetAddr1 (), header,
                                     packet);
 }
@@ -339,7 +615,14 @@ DcaTxop::DoInitialize ()
 {
   NS_LOG_FUNCTION (this);
   m_dcf->ResetCw ();
-  m_dcf->StartBackoffNow (m_rng->GetNext (0, m_dcf->GetCw ()));
+  if (m_backoffCycle > 0)
+    {
+      m_dcf->StartBackoffNow (m_backoffSlot);
+    }
+  else
+    {
+      m_dcf->StartBackoffNow (m_rng->GetNext (0, m_dcf->GetCw ()));
+    }
   ns3::Dcf::DoInitialize ();
 }
 bool
@@ -361,6 +644,10 @@ bool
 DcaTxop::NeedFragmentation (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_fragmentationThreshold != 0)
+    {
+      return m_currentPacket->GetSize () + m_currentHdr.GetSize () + WIFI_MAC_FCS_LENGTH > m_fragmentationThreshold;
+    }
   return m_stationManager->NeedFragmentation (m_currentHdr.GetAddr1 (), &m_currentHdr,
                                               m_currentPacket);
 }
@@ -376,6 +663,10 @@ uint32_t
 DcaTxop::GetFragmentSize (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_fragmentationThreshold != 0)
+    {
+      return GetAdaptiveFragmentSize (m_fragmentNumber);
+    }
   return m_stationManager->GetFragmentSize (m_currentHdr.GetAddr1 (), &m_currentHdr,
                                             m_currentPacket, m_fragmentNumber);
 }
@@ -383,6 +674,10 @@ bool
 DcaTxop::IsLastFragment (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_fragmentationThreshold != 0)
+    {
+      return m_fragmentNumber == GetAdaptiveNFragments ();
+    }
   return m_stationManager->IsLastFragment (m_currentHdr.GetAddr1 (), &m_currentHdr,
                                            m_currentPacket, m_fragmentNumber);
 }
@@ -391,6 +686,10 @@ uint32_t
 DcaTxop::GetNextFragmentSize (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_fragmentationThreshold != 0)
+    {
+      return GetAdaptiveFragmentSize (m_fragmentNumber + 1);
+    }
   return m_stationManager->GetFragmentSize (m_currentHdr.GetAddr1 (), &m_currentHdr,
                                             m_currentPacket, m_fragmentNumber + 1);
 }
@@ -399,10 +698,218 @@ uint32_t
 DcaTxop::GetFragmentOffset (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_fragmentationThreshold != 0)
+    {
+      return m_fragmentNumber * (m_fragmentationThreshold - m_currentHdr.GetSize () - WIFI_MAC_FCS_LENGTH);
+    }
   return m_stationManager->GetFragmentOffset (m_currentHdr.GetAddr1 (), &m_currentHdr,
                                               m_currentPacket, m_fragmentNumber);
 }
 
+uint32_t
+DcaTxop::GetAdaptiveNFragments (void) const
+{
+  NS_ASSERT (m_fragmentationThreshold > m_currentHdr.GetSize () + WIFI_MAC_FCS_LENGTH);
+  uint32_t fragmentPayload = m_fragmentationThreshold - m_currentHdr.GetSize () - WIFI_MAC_FCS_LENGTH;
+  return (m_currentPacket->GetSize () - 1) / fragmentPayload;
+}
+
+uint32_t
+DcaTxop::GetAdaptiveFragmentSize (uint32_t fragmentNumber) const
+{
+  uint32_t fragmentPayload = m_fragmentationThreshold - m_currentHdr.GetSize () - WIFI_MAC_FCS_LENGTH;
+  uint32_t nFragments = GetAdaptiveNFragments ();
+  if (fragmentNumber >= nFragments)
+    {
+      return m_currentPacket->GetSize () - nFragments * fragmentPayload;
+    }
+  return fragmentPayload;
+}
+
+bool
+DcaTxop::ReportDeliveryOutcome (const WifiMacHeader &hdr, bool failed)
+{
+  NS_LOG_FUNCTION (this << hdr << failed);
+  if (m_holdOffThreshold == 0 || m_associations == 0 || !hdr.IsData ())
+    {
+      return false;
+    }
+  Mac48Address address = hdr.GetAddr1 ();
+  uint16_t aid = m_associations->GetAid (address);
+  if (aid == 0)
+    {
+      return false;
+    }
+  if (aid >= m_holdOffs.size ())
+    {
+      StationHoldOff initial = {Mac48Address (), 0, Seconds (0)};
+      m_holdOffs.resize (m_associations->GetAidBound (), initial);
+      m_heldByAid.resize (m_associations->GetAidBound ());
+    }
+  StationHoldOff &holdOff = m_holdOffs[aid];
+  if (holdOff.address != address)
+    {
+      // the AID belonged to another station
+      holdOff.address = address;
+      holdOff.failures = 0;
+    }
+  if (!failed)
+    {
+      holdOff.failures = 0;
+      if (m_heldByAid[aid] == address)
+        {
+          m_heldByAid[aid] = Mac48Address ();
+          m_heldAids.remove (aid);
+        }
+      return false;
+    }
+  holdOff.failures++;
+  if (holdOff.failures % m_holdOffThreshold != 0)
+    {
+      return false;
+    }
+  // the hold-off doubles with each run of failures
+  uint32_t doublings = holdOff.failures / m_holdOffThreshold - 1;
+  Time duration = m_holdOff;
+  for (uint32_t i = 0; i < doublings && duration < m_maxHoldOff; i++)
+    {
+      duration = duration + duration;
+    }
+  duration = Min (duration, m_maxHoldOff);
+  holdOff.until = Simulator::Now () + duration;
+  if (m_heldByAid[aid] != address)
+    {
+      m_heldByAid[aid] = address;
+      m_heldAids.push_back (aid);
+    }
+  NS_LOG_DEBUG ("hold off " << address << " for " << duration << " after "
+                << holdOff.failures << " failures");
+  return true;
+}
+
+void
+DcaTxop::ExpireHoldOffs (void)
+{
+  Time now = Simulator::Now ();
+  for (std::list<uint16_t>::iterator i = m_heldAids.begin (); i != m_heldAids.end (); )
+    {
+      if (m_holdOffs[*i].until <= now)
+        {
+          m_heldByAid[*i] = Mac48Address ();
+          i = m_heldAids.erase (i);
+        }
+      else
+        {
+          i++;
+        }
+    }
+}
+
+bool
+DcaTxop::RequeueCurrentPacket (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_queue->Requeue (m_currentPacket, m_currentHdr, m_currentLatency.GetEnqueueTime ()))
+    {
+      return false;
+    }
+  // forget the frames which outlived the maximum delay in the queue
+  Time now = Simulator::Now ();
+  for (std::map<uint64_t, RequeuedFrame>::iterator i = m_requeuedFrames.begin ();
+       i != m_requeuedFrames.end (); )
+    {
+      if (i->second.latency.GetEnqueueTime () + m_queue->GetMaxDelay () <= now)
+        {
+          m_requeuedFrames.erase (i++);
+        }
+      else
+        {
+          i++;
+        }
+    }
+  RequeuedFrame requeued = {m_currentLatency, now};
+  m_requeuedFrames[m_currentPacket->GetUid ()] = requeued;
+  m_currentPacket = 0;
+  return true;
+}
+
+void
+DcaTxop::DoSetAdaptiveFragmentationThreshold (uint32_t threshold)
+{
+  NS_LOG_FUNCTION (this << threshold);
+  if (threshold != 0 && threshold < 256)
+    {
+      /*
+       * The fragments must leave room for the MAC header and the FCS.
+       * 256 is the smallest fragmentation threshold of the MIB.
+       */
+      NS_LOG_WARN ("Adaptive fragmentation threshold invalid, setting to 256.");
+      threshold = 256;
+    }
+  m_adaptiveFragmentationThreshold = threshold;
+}
+
+uint32_t
+DcaTxop::DoGetAdaptiveFragmentationThreshold (void) const
+{
+  return m_adaptiveFragmentationThreshold;
+}
+
+uint32_t
+DcaTxop::GetAdaptiveFragmentationThreshold (Mac48Address address) const
+{
+  if (!m_adaptiveProtection || m_adaptiveFragmentationThreshold == 0 || address.IsGroup ())
+    {
+      return 0;
+    }
+  StationProtection *protection = m_protection.Find (StationProtections::GetKey (address));
+  if (protection == 0 || protection->level < PROTECTION_RTS_FRAGMENTATION)
+    {
+      return 0;
+    }
+  return m_adaptiveFragmentationThreshold;
+}
+
+void
+DcaTxop::ReportProtectionOutcome (Mac48Address address, bool failed)
+{
+  NS_LOG_FUNCTION (this << address << failed);
+  if (!m_adaptiveProtection)
+    {
+      return;
+    }
+  uint64_t key = StationProtections::GetKey (address);
+  StationProtection *protection = m_protection.Find (key);
+  if (protection == 0)
+    {
+      StationProtection initial = {0, 0, PROTECTION_NONE};
+      protection = m_protection.Insert (key, initial);
+    }
+  protection->attempts++;
+  if (failed)
+    {
+      protection->failures++;
+    }
+  if (protection->attempts < m_protectionWindow)
+    {
+      return;
+    }
+  double ratio = protection->failures / static_cast<double> (protection->attempts);
+  enum ProtectionLevel maxLevel = m_adaptiveFragmentationThreshold != 0 ? PROTECTION_RTS_FRAGMENTATION : PROTECTION_RTS;
+  if (ratio >= m_rtsEnableRetryRatio && protection->level < maxLevel)
+    {
+      protection->level = static_cast<enum ProtectionLevel> (protection->level + 1);
+      NS_LOG_DEBUG ("retry ratio=" << ratio << " to " << address << ", protection level=" << protection->level);
+    }
+  else if (ratio <= m_rtsDisableRetryRatio && protection->level > PROTECTION_NONE)
+    {
+      protection->level = static_cast<enum ProtectionLevel> (protection->level - 1);
+      NS_LOG_DEBUG ("retry ratio=" << ratio << " to " << address << ", protection level=" << protection->level);
+    }
+  protection->attempts = 0;
+  protection->failures = 0;
+}
+
 Ptr<Packet>
 DcaTxop::GetFragmentPacket (WifiMacHeader *hdr)
 {
@@ -424,24 +931,122 @@ DcaTxop::GetFragmentPacket (WifiMacHeader *hdr)
   return fragment;
 }
 
+void
+DcaTxop::RecordTxAttempt (Ptr<const Packet> packet, const WifiMacHeader *hdr,
+                          const MacLowTransmissionParameters &params)
+{
+  NS_LOG_FUNCTION (this << packet << hdr);
+  Time duration = Low ()->CalculateTransmissionTime (packet, hdr, params);
+  m_currentLatency.AddAttempt (duration);
+  if (hdr->IsMgt ())
+    {
+      UpdateManagementShareWindow ();
+      m_managementAirtime += duration;
+    }
+}
+
+bool
+DcaTxop::IsClient (Mac48Address address)
+{
+  uint16_t aid = m_associations != 0 ? m_associations->GetAid (address) : 0;
+  if (aid != 0 && aid < m_clientByAid.size () && m_clientByAid[aid] == address)
+    {
+      return true;
+    }
+  // destinations which are not associated (yet), or whose AID is not
+  // indexed yet, are searched for in the list
+  if (std::find (m_clients.begin (), m_clients.end (), address) == m_clients.end ())
+    {
+      return false;
+    }
+  IndexClient (address, aid);
+  return true;
+}
+
+void
+DcaTxop::AddClient (Mac48Address address)
+{
+  m_clients.push_back (address);
+  IndexClient (address, m_associations != 0 ? m_associations->GetAid (address) : 0);
+}
+
+void
+DcaTxop::IndexClient (Mac48Address address, uint16_t aid)
+{
+  if (aid == 0)
+    {
+      return;
+    }
+  if (aid >= m_clientByAid.size ())
+    {
+      m_clientByAid.resize (aid + 1);
+    }
+  m_clientByAid[aid] = address;
+}
+
+bool
+DcaTxop::IsQueueEmpty (void) const
+{
+  return m_queue->IsEmpty () && m_managementQueue->IsEmpty () && m_priorityQueue->IsEmpty ();
+}
+
+void
+DcaTxop::UpdateManagementShareWindow (void)
+{
+  Time now = Simulator::Now ();
+  if (now - m_managementWindowStart >= m_managementShareWindow)
+    {
+      m_managementWindowStart = now;
+      m_managementAirtime = Seconds (0.0);
+    }
+}
+
+bool
+DcaTxop::IsManagementShareExceeded (void) const
+{
+  return m_managementAirtime.GetSeconds () > m_maxManagementShare * m_managementShareWindow.GetSeconds ();
+}
+
+void
+DcaTxop::ReportLatency (bool success)
+{
+  NS_LOG_FUNCTION (this << success);
+  m_lastServiceEnd = Simulator::Now ();
+  m_macLatencyTrace (m_currentPacket, m_currentLatency, success);
+}
+
 bool
 DcaTxop::NeedsAccess (void) const
 {
   NS_LOG_FUNCTION (this);
-  return !m_queue->IsEmpty () || m_currentPacket != 0;
+  return !IsQueueEmpty () || m_currentPacket != 0;
 }
 void
 DcaTxop::NotifyAccessGranted (void)
 {
   NS_LOG_FUNCTION (this);
+  if (DeferToAccessWindow ())
+    {
+      NS_LOG_DEBUG ("access granted outside of the access window");
+      return;
+    }
   if (m_currentPacket == 0)
     {
-      if (m_queue->IsEmpty ())
+      if (IsQueueEmpty ())
         {
           NS_LOG_DEBUG ("queue empty");
           return;
         }
-      if(m_low->GetBssid()==m_low->GetAddress()){
+      UpdateManagementShareWindow ();
+      if (!m_managementQueue->IsEmpty ()
+          && ((m_queue->IsEmpty () && m_priorityQueue->IsEmpty ())
+              || !IsManagementShareExceeded ()))
+        {
+          // management frames are neither held back by the scheduler
+          // nor queued behind data frames
+          m_currentPacket = m_managementQueue->Dequeue (&m_currentHdr);
+        }
+      else if(m_low->GetBssid()==m_low->GetAddress()){
       //std::cout<<"just before compare"<<std::endl;
       Time time_now=Simulator::Now();
       //if((schedTime.Compare(Seconds(0.0))==0) || ((Simulator::Now().GetMilliSeconds()-schedTime.GetMilliSeconds())<=10)){
@@ -462,18 +1067,75 @@ DcaTxop::NotifyAccessGranted (void)
      	 // std::cout<<"time="<<Simulator::Now().GetSeconds()<<"sched time="<<schedTime.GetSeconds()<<" access granted Queue packet at"<<m_low->GetAddress()<<" addr="<<*schedI<<std::endl;
      	  active_clients.push_back(*schedI);
        }
+       m_activeChanged = true;
       }
-      m_currentPacket = m_queue->DequeueByAddresses(&m_currentHdr,active_clients,m_clients);
+      if (m_associations != 0)
+        {
+          if (m_activeChanged || m_activeGeneration != m_associations->GetGeneration ())
+            {
+              // the active clients or their AIDs changed
+              m_activeChanged = false;
+              m_activeGeneration = m_associations->GetGeneration ();
+              m_activeByAid.assign (m_associations->GetAidBound (), Mac48Address ());
+              for (clientsI it = active_clients.begin (); it != active_clients.end (); it++)
+                {
+                  uint16_t aid = m_associations->GetAid (*it);
+                  if (aid != 0)
+                    {
+                      m_activeByAid[aid] = *it;
+                    }
+                }
+            }
+          ExpireHoldOffs ();
+          m_currentPacket = m_queue->DequeueByAids (&m_currentHdr, *m_associations, m_activeByAid, m_heldByAid);
+        }
+      else
+        {
+          m_currentPacket = m_queue->DequeueByAddresses(&m_currentHdr,active_clients,m_clients);
+        }
       }
+      else if (!m_priorityQueue->IsEmpty ()
+               && (m_queue->IsEmpty () || m_priorityBurst < m_maxPriorityBurst))
+        {
+          m_currentPacket = m_priorityQueue->Dequeue (&m_currentHdr);
+          m_priorityBurst++;
+        }
       else{
       m_currentPacket = m_queue->Dequeue (&m_currentHdr);
+      m_priorityBurst = 0;
       }
       NS_ASSERT (m_currentPacket != 0);
-      uint16_t sequence = m_txMiddle->GetNextSequenceNumberfor (&m_currentHdr);
-      m_currentHdr.SetSequenceNumber (sequence);
+      std::map<uint64_t, RequeuedFrame>::iterator requeued = m_requeuedFrames.find (m_currentPacket->GetUid ());
+      if (requeued != m_requeuedFrames.end ())
+        {
+          // a frame put back in the queue by a hold-off keeps its
+          // counters, and the time it spent back in the queue is queue wait
+          m_currentLatency = requeued->second.latency;
+          m_latencyReady = Max (requeued->second.requeued, m_lastServiceEnd);
+          m_currentLatency.SetQueueWait (m_currentLatency.GetQueueWait ()
+                                         + m_latencyReady - requeued->second.requeued);
+          m_requeuedFrames.erase (requeued);
+        }
+      else
+        {
+          m_currentLatency = MacLatencyTag ();
+          if (!m_currentPacket->PeekPacketTag (m_currentLatency))
+            {
+              m_currentLatency.SetEnqueueTime (Simulator::Now ());
+            }
+          m_latencyReady = Max (m_currentLatency.GetEnqueueTime (), m_lastServiceEnd);
+          m_currentLatency.SetQueueWait (m_latencyReady - m_currentLatency.GetEnqueueTime ());
+        }
+      if (!m_currentHdr.IsRetry ())
+        {
+          // a frame put back in the queue by a hold-off is a retransmission
+          // and keeps its sequence number
+          uint16_t sequence = m_txMiddle->GetNextSequenceNumberfor (&m_currentHdr);
+          m_currentHdr.SetSequenceNumber (sequence);
+        }
       m_currentHdr.SetFragmentNumber (0);
+      m_fragmentationThreshold = GetAdaptiveFragmentationThreshold (m_currentHdr.GetAddr1 ());
       m_currentHdr.SetNoMoreFragments ();
-      m_currentHdr.SetNoRetry ();
       m_fragmentNumber = 0;
       NS_LOG_DEBUG ("dequeued size=" << m_currentPacket->GetSize () <<
                     ", to=" << m_currentHdr.GetAddr1 () <<
@@ -482,13 +1144,30 @@ DcaTxop::NotifyAccessGranted (void)
         //                  ", to=" << m_currentHdr.GetAddr1 () <<
           //                ", seq=" << m_currentHdr.GetSequenceControl ()<<std::endl;
     }
+  m_currentLatency.AddAccessDelay (Simulator::Now () - m_latencyReady);
   MacLowTransmissionParameters params;
   params.DisableOverrideDurationId ();
-  if (m_currentHdr.GetAddr1 ().IsGroup ())
+  if (m_currentHdr.IsCfpoll ())
+    {
+      // the duration of a CF-Poll covers the rest of the contention-free
+      // period and no station acknowledges it
+      params.EnableOverrideDurationId (m_currentHdr.GetDuration ());
+      params.DisableRts ();
+      params.DisableAck ();
+      params.DisableNextData ();
+      RecordTxAttempt (m_currentPacket, &m_currentHdr, params);
+      Low ()->StartTransmission (m_currentPacket,
+                                 &m_currentHdr,
+                                 params,
+                                 m_transmissionListener);
+      NS_LOG_DEBUG ("tx CF-Poll");
+    }
+  else if (m_currentHdr.GetAddr1 ().IsGroup ())
     {
       params.DisableRts ();
       params.DisableAck ();
       params.DisableNextData ();
+      RecordTxAttempt (m_currentPacket, &m_currentHdr, params);
       Low ()->StartTransmission (m_currentPacket,
                                  &m_currentHdr,
                                  params,
@@ -503,7 +1182,7 @@ DcaTxop::NotifyAccessGranted (void)
         {
           WifiMacHeader hdr;
           Ptr<Packet> fragment = GetFragmentPacket (&hdr);
-          if (NeedRts (fragment, &hdr))
+          if (NeedRts (fragment, &hdr) && !m_polled)
             {
               params.EnableRts ();
             }
@@ -521,12 +1200,13 @@ DcaTxop::NotifyAccessGranted (void)
               NS_LOG_DEBUG ("fragmenting size=" << fragment->GetSize ());
               params.EnableNextData (GetNextFragmentSize ());
             }
+          RecordTxAttempt (fragment, &hdr, params);
           Low ()->StartTransmission (fragment, &hdr, params,
                                      m_transmissionListener);
         }
       else
         {
-          if (NeedRts (m_currentPacket, &m_currentHdr))
+          if (NeedRts (m_currentPacket, &m_currentHdr) && !m_polled)
             {
               params.EnableRts ();
               NS_LOG_DEBUG ("tx unicast rts");
@@ -537,6 +1217,7 @@ DcaTxop::NotifyAccessGranted (void)
               NS_LOG_DEBUG ("tx unicast");
             }
           params.DisableNextData ();
+          RecordTxAttempt (m_currentPacket, &m_currentHdr, params);
           Low ()->StartTransmission (m_currentPacket, &m_currentHdr,
                                      params, m_transmissionListener);
         }
@@ -564,6 +1245,9 @@ DcaTxop::NotifyChannelSwitching (void)
 {
   NS_LOG_FUNCTION (this);
   m_queue->Flush ();
+  m_managementQueue->Flush ();
+  m_priorityQueue->Flush ();
+  m_requeuedFrames.clear ();
   m_currentPacket = 0;
 }
 
@@ -578,6 +1262,7 @@ DcaTxop::MissedCts (void)
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_DEBUG ("missed cts");
+  ReportProtectionOutcome (m_currentHdr.GetAddr1 (), true);
   if (!NeedRtsRetransmission ())
     {
       NS_LOG_DEBUG ("Cts Fail");
@@ -586,12 +1271,14 @@ DcaTxop::MissedCts (void)
         {
           m_txFailedCallback (m_currentHdr);
         }
+      ReportLatency (false);
       // to reset the dcf.
       m_currentPacket = 0;
       m_dcf->ResetCw ();
     }
   else
     {
+      m_latencyReady = Simulator::Now ();
       m_dcf->UpdateFailedCw ();
     }
   m_dcf->StartBackoffNow (m_rng->GetNext (0, m_dcf->GetCw ()));
@@ -601,6 +1288,8 @@ void
 DcaTxop::GotAck (double snr, WifiMode txMode)
 {
   NS_LOG_FUNCTION (this << snr << txMode);
+  ReportProtectionOutcome (m_currentHdr.GetAddr1 (), false);
+  ReportDeliveryOutcome (m_currentHdr, false);
   if (!NeedFragmentation ()
       || IsLastFragment ())
     {
@@ -609,13 +1298,22 @@ DcaTxop::GotAck (double snr, WifiMode txMode)
         {
           m_txOkCallback (m_currentHdr);
         }
+      ReportLatency (true);
 
       /* we are not fragmenting or we are done fragmenting
        * so we can get rid of that packet now.
        */
       m_currentPacket = 0;
       m_dcf->ResetCw ();
-      m_dcf->StartBackoffNow (m_rng->GetNext (0, m_dcf->GetCw ()));
+      if (m_backoffCycle > 0)
+        {
+          // the transmission took one slot of the cycle
+          m_dcf->StartBackoffNow (m_backoffCycle - 1);
+        }
+      else
+        {
+          m_dcf->StartBackoffNow (m_rng->GetNext (0, m_dcf->GetCw ()));
+        }
       RestartAccessIfNeeded ();
     }
   else
@@ -628,7 +1326,30 @@ DcaTxop::MissedAck (void)
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_DEBUG ("missed ack");
-  if (!NeedDataRetransmission ())
+  ReportProtectionOutcome (m_currentHdr.GetAddr1 (), true);
+  bool heldOff = ReportDeliveryOutcome (m_currentHdr, true);
+  bool retransmit = NeedDataRetransmission ();
+  bool requeued = false;
+  if (retransmit && heldOff && m_fragmentNumber == 0)
+    {
+      // let the other stations go first: the frame goes back to the
+      // queue, and the next one, for another station, starts afresh
+      NS_LOG_DEBUG ("requeue frame to " << m_currentHdr.GetAddr1 ());
+      m_currentHdr.SetRetry ();
+      requeued = RequeueCurrentPacket ();
+      if (requeued)
+        {
+          m_dcf->ResetCw ();
+        }
+      else
+        {
+          // the frame cannot wait in the queue: drop it like a frame
+          // which ran out of retries
+          NS_LOG_DEBUG ("cannot requeue frame to " << m_currentHdr.GetAddr1 ());
+          retransmit = false;
+        }
+    }
+  if (!retransmit)
     {
       NS_LOG_DEBUG ("Ack Fail");
       std::cout<<"T="<<Simulator::Now().GetSeconds()<<"Maxretry at "<<m_low->GetAddress()<<"packet="<<*m_currentPacket<<std::endl;
@@ -637,13 +1358,15 @@ DcaTxop::MissedAck (void)
         {
           m_txFailedCallback (m_currentHdr);
         }
+      ReportLatency (false);
       // to reset the dcf.
       m_currentPacket = 0;
       m_dcf->ResetCw ();
     }
-  else
+  else if (!requeued)
     {
       NS_LOG_DEBUG ("Retransmit");
+      m_latencyReady = Simulator::Now ();
       std::cout<<"retx at "<<m_low->GetAddress()<<"at time="<<Simulator::Now().GetSeconds()<<std::endl;
       m_currentHdr.SetRetry ();
       m_dcf->UpdateFailedCw ();
@@ -672,6 +1395,7 @@ DcaTxop::StartNext (void)
     {
       params.EnableNextData (GetNextFragmentSize ());
     }
+  RecordTxAttempt (fragment, &hdr, params);
   Low ()->StartTransmission (fragment, &hdr, params, m_transmissionListener);
 }
 
@@ -712,6 +1436,12 @@ DcaTxop::EndTxNoAck (void)
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_DEBUG ("a transmission that did not require an ACK just finished");
+  ReportLatency (true);
+  if (m_currentHdr.IsCfpoll () && !m_txOkCallback.IsNull ())
+    {
+      // the AP waits for the end of a CF-Poll to time out the answer
+      m_txOkCallback (m_currentHdr);
+    }
   m_currentPacket = 0;
   m_dcf->ResetCw ();
   m_dcf->StartBackoffNow (m_rng->GetNext (0, m_dcf->GetCw ()));
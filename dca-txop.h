@@ -22,6 +22,8 @@
 #define DCA_TXOP_H
 
 #include <stdint.h>
+#include <vector>
+#include <map>
 #include "ns3/callback.h"
 #include "ns3/packet.h"
 #include "ns3/nstime.h"
@@ -29,7 +31,12 @@
 #include "ns3/wifi-mac-header.h"
 #include "ns3/wifi-mode.h"
 #include "ns3/wifi-remote-station-manager.h"
+#include "ns3/traced-callback.h"
+#include "ns3/event-id.h"
 #include "ns3/dcf.h"
+#include "mac-latency-tag.h"
+#include "mac-address-hash-map.h"
+#include "association-table.h"
 
 namespace ns3 {
 
@@ -37,6 +44,7 @@ class DcfState;
 class DcfManager;
 class WifiMacQueue;
 class MacLow;
+class MacLowTransmissionParameters;
 class WifiMacParameters;
 class MacTxMiddle;
 class RandomStream;
@@ -63,6 +71,13 @@ class MacStations;
  *
  * The rts/cts policy is similar to the fragmentation policy: when
  * a packet is bigger than a threshold, the rts/cts protocol is used.
+ *
+ * When the AdaptiveProtection attribute is set, both policies can also
+ * be enabled per destination: the retry ratio observed towards each
+ * destination is measured over windows of ProtectionWindow attempts.
+ * A ratio above RtsEnableRetryRatio turns rts/cts on, and then (if
+ * AdaptiveFragmentationThreshold is not 0) fragmentation as well; a
+ * ratio below RtsDisableRetryRatio steps back down.
  */
 class DcaTxop : public Dcf
 {
@@ -125,6 +140,11 @@ public:
   virtual uint32_t GetMinCw (void) const;
   virtual uint32_t GetMaxCw (void) const;
   virtual uint32_t GetAifsn (void) const;
+  virtual void SetIdleSense (bool enable);
+  virtual bool GetIdleSense (void) const;
+  virtual void SetIdleSenseTarget (double target);
+  virtual double GetIdleSenseTarget (void) const;
+  virtual const DcfState * GetDcfState (void) const;
 
   /**
    * \param packet packet to send
@@ -134,6 +154,15 @@ public:
    * can be sent safely.
    */
   void Queue (Ptr<const Packet> packet, const WifiMacHeader &hdr);
+  /**
+   * \param packet packet to send
+   * \param hdr header of packet to send.
+   *
+   * Store the packet with the management frames, which are sent first.
+   * Unlike Queue, the destination is not made a client of the
+   * downlink scheduler of the AP: this is meant for the CF-Polls.
+   */
+  void QueueUnscheduled (Ptr<const Packet> packet, const WifiMacHeader &hdr);
 
  /**
   * Assign a fixed random variable stream number to the random variables
@@ -145,6 +174,56 @@ public:
   */
   int64_t AssignStreams (int64_t stream);
 
+  /**
+   * Only contend for the medium during periodic access windows: the
+   * n-th window starts at start + n * period and lasts for duration.
+   * Outside of these windows, access requests are deferred to the
+   * start of the next window, where a new backoff is drawn.
+   *
+   * \param start the start of the first window
+   * \param duration the duration of each window
+   * \param period the interval between the start of two windows
+   */
+  void SetAccessWindow (Time start, Time duration, Time period);
+  /**
+   * Contend for the medium at any time (the default).
+   */
+  void ClearAccessWindow (void);
+  /**
+   * Called a SIFS after a CF-Poll from the AP was received: transmit
+   * the next frame right away, if there is one, whatever the state of
+   * the backoff and of the access windows.
+   */
+  void NotifyPolled (void);
+  /**
+   * Use a deterministic backoff: the next backoff lasts slot slots and,
+   * after each successful transmission, the backoff lasts for the rest
+   * of a cycle of cycle slots, so that the stations which were given
+   * distinct slots do not collide. After a failure, the backoff is
+   * random until the next success.
+   *
+   * \param slot the backoff slot assigned to this station
+   * \param cycle the number of slots of a cycle
+   */
+  void SetBackoffSlot (uint32_t slot, uint32_t cycle);
+  /**
+   * Go back to the random backoff of the DCF (the default).
+   */
+  void ClearBackoffSlot (void);
+  /**
+   * \return the clients of the AP, the ones being served first, then
+   *         the others in the order in which the scheduler will serve
+   *         them
+   */
+  std::list<Mac48Address> GetSchedulerOrder (void) const;
+  /**
+   * Let the scheduler of the AP find its clients by AID instead of
+   * searching its lists of clients.
+   *
+   * \param table the association table of the AP
+   */
+  void SetAssociationTable (Ptr<AssociationTable> table);
+
 private:
   class TransmissionListener;
   class NavListener;
@@ -301,6 +380,126 @@ private:
    * \return the fragment with the current fragment number
    */
   Ptr<Packet> GetFragmentPacket (WifiMacHeader *hdr);
+  /**
+   * Account for a new transmission attempt of the current packet in
+   * its MacLatencyTag.
+   *
+   * \param packet the packet (or fragment) about to be sent
+   * \param hdr the header of the packet (or fragment)
+   * \param params the transmission parameters given to MacLow
+   */
+  void RecordTxAttempt (Ptr<const Packet> packet, const WifiMacHeader *hdr,
+                        const MacLowTransmissionParameters &params);
+  /**
+   * The current packet leaves the MAC: report its MacLatencyTag.
+   *
+   * \param success true if the packet was acknowledged (or did not
+   *        need an acknowledgment), false if it was dropped
+   */
+  void ReportLatency (bool success);
+  /**
+   * \return true if none of the data, priority and management queues
+   *         holds a frame
+   */
+  bool IsQueueEmpty (void) const;
+  /**
+   * Start a new measurement window of the airtime share of management
+   * frames if the current one is over.
+   */
+  void UpdateManagementShareWindow (void);
+  /**
+   * While this returns true, management frames are only sent when
+   * neither the data queue nor the priority queue holds a frame.
+   *
+   * \return true if management frames used more than their share of
+   *         the airtime in the current measurement window
+   */
+  bool IsManagementShareExceeded (void) const;
+  /**
+   * \param address the destination of a frame
+   * \return true if the destination is in the list of clients of the
+   *         scheduler
+   */
+  bool IsClient (Mac48Address address);
+  /**
+   * \param address a new client of the scheduler
+   */
+  void AddClient (Mac48Address address);
+  /**
+   * \param address a client of the scheduler
+   * \param aid the AID of the client, 0 if it is not associated
+   */
+  void IndexClient (Mac48Address address, uint16_t aid);
+  /**
+   * Update the adaptive protection state of a destination with the
+   * outcome of one transmission attempt.
+   *
+   * \param address the destination of the attempt
+   * \param failed true if the attempt was not acknowledged
+   */
+  void ReportProtectionOutcome (Mac48Address address, bool failed);
+  /**
+   * \param address the destination of a new packet
+   * \return the fragmentation threshold to use for this packet, or 0 to
+   *         let the WifiRemoteStationManager decide
+   */
+  uint32_t GetAdaptiveFragmentationThreshold (Mac48Address address) const;
+  /**
+   * \param threshold the fragmentation threshold used for destinations
+   *        that still suffer losses with rts/cts, 0 to disable adaptive
+   *        fragmentation. Non-zero values below 256 are raised to 256.
+   */
+  void DoSetAdaptiveFragmentationThreshold (uint32_t threshold);
+  /**
+   * \return the fragmentation threshold used for destinations that
+   *         still suffer losses with rts/cts, 0 if disabled
+   */
+  uint32_t DoGetAdaptiveFragmentationThreshold (void) const;
+  /**
+   * Update the consecutive failures of the destination of a data frame
+   * sent by the AP, and hold the destination off when they reach a
+   * multiple of the hold-off threshold.
+   *
+   * \param hdr the header of the frame
+   * \param failed true if the attempt was not acknowledged
+   * \return true if the destination has just been held off
+   */
+  bool ReportDeliveryOutcome (const WifiMacHeader &hdr, bool failed);
+  /**
+   * Release the destinations whose hold-off is over.
+   */
+  void ExpireHoldOffs (void);
+  /**
+   * Put the current packet back at the front of the data queue, with
+   * its enqueue time, and keep its latency counters until it is
+   * dequeued again.
+   *
+   * \return false if the queue could not take the packet back, which
+   *         is then still the current packet
+   */
+  bool RequeueCurrentPacket (void);
+  /**
+   * \param fragmentNumber a fragment of the current packet
+   * \return the size of this fragment when the current packet is
+   *         fragmented with an adaptive threshold
+   */
+  uint32_t GetAdaptiveFragmentSize (uint32_t fragmentNumber) const;
+  /**
+   * \return the number of fragments preceding the last one when the
+   *         current packet is fragmented with an adaptive threshold
+   */
+  uint32_t GetAdaptiveNFragments (void) const;
+  /**
+   * If the current time is outside of the access windows, make sure
+   * that AccessWindowStart is scheduled at the start of the next one.
+   *
+   * \return true if access must be deferred, false otherwise
+   */
+  bool DeferToAccessWindow (void);
+  /**
+   * Called at the start of an access window.
+   */
+  void AccessWindowStart (void);
   virtual void DoDispose (void);
 
   Dcf *m_dcf;
@@ -308,6 +507,8 @@ private:
   TxOk m_txOkCallback;
   TxFailed m_txFailedCallback;
   Ptr<WifiMacQueue> m_queue;
+  Ptr<WifiMacQueue> m_managementQueue; //!< management frames, sent before the data frames
+  Ptr<WifiMacQueue> m_priorityQueue; //!< small data frames of a non-AP station, sent before m_queue
 
   MacTxMiddle *m_txMiddle;
   Ptr <MacLow> m_low;
@@ -318,6 +519,11 @@ private:
   std::list<Mac48Address> active_clients;
   typedef std::list<Mac48Address>::iterator clientsI;
   std::list<Mac48Address>::iterator schedI;
+  Ptr<AssociationTable> m_associations; //!< association table of the AP, if any
+  std::vector<Mac48Address> m_clientByAid; //!< address of each client at the index of its AID
+  std::vector<Mac48Address> m_activeByAid; //!< address of each active client at the index of its AID
+  uint32_t m_activeGeneration; //!< generation of the association table when m_activeByAid was built
+  bool m_activeChanged; //!< whether active_clients changed since m_activeByAid was built
   Time schedTime;
   uint32_t numClients;
   bool m_accessOngoing;
@@ -325,6 +531,71 @@ private:
   WifiMacHeader m_currentHdr;
   uint8_t m_fragmentNumber;
   uint32_t counter;
+
+  MacLatencyTag m_currentLatency; //!< latency breakdown of m_currentPacket
+  Time m_latencyReady;            //!< when m_currentPacket became ready to contend
+  Time m_lastServiceEnd;          //!< when the previous packet left the MAC
+  /**
+   * The trace source fired when a packet is acknowledged (true) or
+   * dropped (false), with the breakdown of its MAC latency.
+   */
+  TracedCallback<Ptr<const Packet>, const MacLatencyTag &, bool> m_macLatencyTrace;
+
+  enum ProtectionLevel
+  {
+    PROTECTION_NONE,
+    PROTECTION_RTS,
+    PROTECTION_RTS_FRAGMENTATION
+  };
+  struct StationProtection
+  {
+    uint32_t attempts;      //!< attempts in the current window
+    uint32_t failures;      //!< unacknowledged attempts in the current window
+    enum ProtectionLevel level;
+  };
+  typedef MacAddressHashMap<StationProtection> StationProtections;
+  StationProtections m_protection;
+  bool m_adaptiveProtection;
+  double m_rtsEnableRetryRatio;
+  double m_rtsDisableRetryRatio;
+  uint32_t m_protectionWindow;
+  uint32_t m_adaptiveFragmentationThreshold;
+  uint32_t m_fragmentationThreshold; //!< adaptive threshold of m_currentPacket, 0 if none
+
+  bool m_accessWindow; //!< whether access is restricted to the access windows
+  Time m_accessWindowStart;
+  Time m_accessWindowDuration;
+  Time m_accessWindowPeriod;
+  EventId m_accessWindowEvent;
+  bool m_polled; //!< whether the current access was granted by a CF-Poll
+  uint32_t m_backoffSlot; //!< backoff slot assigned by the AP
+  uint32_t m_backoffCycle; //!< number of slots of a deterministic backoff cycle, 0 if random
+  double m_maxManagementShare;
+  Time m_managementShareWindow;
+  Time m_managementWindowStart; //!< start of the current measurement window
+  Time m_managementAirtime;     //!< airtime of management frames in the current window
+  uint32_t m_priorityThreshold;
+  uint32_t m_maxPriorityBurst;
+  uint32_t m_priorityBurst; //!< frames of the priority band served since the last bulk frame
+
+  struct StationHoldOff
+  {
+    Mac48Address address;   //!< station the AID belongs to
+    uint32_t failures;      //!< consecutive failed attempts
+    Time until;             //!< end of the current hold-off
+  };
+  std::vector<StationHoldOff> m_holdOffs; //!< hold-off state of each station at the index of its AID
+  std::vector<Mac48Address> m_heldByAid; //!< address of each held-off station at the index of its AID
+  std::list<uint16_t> m_heldAids; //!< AIDs of the held-off stations
+  struct RequeuedFrame
+  {
+    MacLatencyTag latency;  //!< latency counters of the frame when it was put back
+    Time requeued;          //!< time the frame was put back in the queue
+  };
+  std::map<uint64_t, RequeuedFrame> m_requeuedFrames; //!< frames put back in the queue by a hold-off, by packet UID
+  uint32_t m_holdOffThreshold;
+  Time m_holdOff;
+  Time m_maxHoldOff;
 };
 
 } // namespace ns3
@@ -22,6 +22,7 @@
 #include "ns3/log.h"
 #include "ns3/simulator.h"
 #include <cmath>
+#include <algorithm>
 
 #include "dcf-manager.h"
 #include "wifi-phy.h"
@@ -35,17 +36,93 @@ NS_LOG_COMPONENT_DEFINE ("DcfManager");
 
 namespace ns3 {
 
+/*
+ * Idle Sense parameters, see M. Heusse et al., "Idle Sense: an optimal
+ * access method for high throughput and fairness in rate diverse
+ * wireless LANs", SIGCOMM 2005.
+ */
+static const uint32_t IDLE_SENSE_MAX_TRANSMISSIONS = 5;
+static const double IDLE_SENSE_INCREASE = 6.0;
+static const double IDLE_SENSE_DECREASE = 1.0666;
+
+/****************************************************************
+ *      Implement the fixed-bucket histogram
+ ****************************************************************/
+
+DcfHistogram::DcfHistogram (Time bucketWidth, uint32_t nBuckets)
+  : m_bucketWidth (bucketWidth.GetTimeStep ()),
+    m_buckets (nBuckets, 0),
+    m_count (0),
+    m_sum (0)
+{
+  NS_ASSERT (m_bucketWidth > 0 && nBuckets > 0);
+}
+
+void
+DcfHistogram::Add (Time duration)
+{
+  int64_t steps = std::max (duration.GetTimeStep (), static_cast<int64_t> (0));
+  int64_t bucket = std::min (steps / m_bucketWidth, static_cast<int64_t> (m_buckets.size () - 1));
+  m_buckets[bucket]++;
+  m_count++;
+  m_sum += steps;
+}
+void
+DcfHistogram::Reset (void)
+{
+  std::fill (m_buckets.begin (), m_buckets.end (), 0);
+  m_count = 0;
+  m_sum = 0;
+}
+Time
+DcfHistogram::GetBucketWidth (void) const
+{
+  return TimeStep (m_bucketWidth);
+}
+uint32_t
+DcfHistogram::GetNBuckets (void) const
+{
+  return m_buckets.size ();
+}
+uint64_t
+DcfHistogram::GetBucketCount (uint32_t bucket) const
+{
+  NS_ASSERT (bucket < m_buckets.size ());
+  return m_buckets[bucket];
+}
+uint64_t
+DcfHistogram::GetCount (void) const
+{
+  return m_count;
+}
+Time
+DcfHistogram::GetSum (void) const
+{
+  return TimeStep (m_sum);
+}
+
 /****************************************************************
  *      Implement the DCF state holder
  ****************************************************************/
 
 DcfState::DcfState ()
   : m_backoffSlots (0),
-    m_backoffStart (Seconds (0.0)),
+    m_backoffStart (0),
     m_cwMin (0),
     m_cwMax (0),
     m_cw (0),
-    m_accessRequested (false)
+    m_accessRequested (false),
+    m_accessRequestTime (0),
+    m_lastAccessDelay (Seconds (0.0)),
+    m_accessDelays (MicroSeconds (250), 400),
+    m_backoffFreezes (0),
+    m_collisions (0),
+    m_internalCollisions (0),
+    m_idleSense (false),
+    m_idleSenseTarget (3.91),
+    m_idleSenseCw (0),
+    m_idleSenseTransmissions (0),
+    m_idleSenseSlots (0)
 {
 }
 
@@ -86,19 +163,78 @@ DcfState::GetCwMax (void) const
   return m_cwMax;
 }
 
+void
+DcfState::SetIdleSense (bool enable)
+{
+  m_idleSense = enable;
+  m_idleSenseCw = m_cw;
+  m_idleSenseTransmissions = 0;
+  m_idleSenseSlots = 0;
+  ResetCw ();
+}
+bool
+DcfState::GetIdleSense (void) const
+{
+  return m_idleSense;
+}
+void
+DcfState::SetIdleSenseTarget (double target)
+{
+  m_idleSenseTarget = target;
+}
+double
+DcfState::GetIdleSenseTarget (void) const
+{
+  return m_idleSenseTarget;
+}
+
 void
 DcfState::ResetCw (void)
 {
+  if (m_idleSense)
+    {
+      m_idleSenseCw = std::max (std::min (m_idleSenseCw, static_cast<double> (m_cwMax)),
+                                static_cast<double> (m_cwMin));
+      m_cw = static_cast<uint32_t> (m_idleSenseCw + 0.5);
+      return;
+    }
   m_cw = m_cwMin;
 }
 void
 DcfState::UpdateFailedCw (void)
 {
+  if (m_idleSense)
+    {
+      return;
+    }
   // see 802.11-2007, section 9.9.1.5
   m_cw = std::min ( 2 * (m_cw + 1) - 1, m_cwMax);
 }
 void
-DcfState::UpdateBackoffSlotsNow (uint32_t nSlots, Time backoffUpdateBound)
+DcfState::NotifyIdleSlots (uint32_t nSlots)
+{
+  m_idleSenseSlots += nSlots;
+  m_idleSenseTransmissions++;
+  if (m_idleSenseTransmissions < IDLE_SENSE_MAX_TRANSMISSIONS)
+    {
+      return;
+    }
+  double meanIdleSlots = m_idleSenseSlots / static_cast<double> (m_idleSenseTransmissions);
+  if (meanIdleSlots < m_idleSenseTarget)
+    {
+      m_idleSenseCw += IDLE_SENSE_INCREASE;
+    }
+  else
+    {
+      m_idleSenseCw /= IDLE_SENSE_DECREASE;
+    }
+  MY_DEBUG ("idle sense: mean idle slots=" << meanIdleSlots << ", cw=" << m_idleSenseCw);
+  m_idleSenseTransmissions = 0;
+  m_idleSenseSlots = 0;
+  ResetCw ();
+}
+void
+DcfState::UpdateBackoffSlotsNow (uint32_t nSlots, int64_t backoffUpdateBound)
 {
   m_backoffSlots -= nSlots;
   m_backoffStart = backoffUpdateBound;
@@ -114,7 +250,15 @@ DcfState::StartBackoffNow (uint32_t nSlots)
   MY_DEBUG ("start backoff=" << nSlots << " slots");
   //std::cout<<"start backoff="<<nSlots<<"at time="<<Simulator::Now().GetSeconds()<<std::endl;
   m_backoffSlots = nSlots;
-  m_backoffStart = Simulator::Now ();
+  m_backoffStart = Simulator::Now ().GetTimeStep ();
+}
+
+void
+DcfState::RestartBackoffNow (uint32_t nSlots)
+{
+  NS_ASSERT (!m_accessRequested);
+  m_backoffSlots = 0;
+  StartBackoffNow (nSlots);
 }
 
 uint32_t
@@ -127,7 +271,7 @@ DcfState::GetBackoffSlots (void) const
 {
   return m_backoffSlots;
 }
-Time
+int64_t
 DcfState::GetBackoffStart (void) const
 {
   return m_backoffStart;
@@ -137,26 +281,64 @@ DcfState::IsAccessRequested (void) const
 {
   return m_accessRequested;
 }
+const DcfHistogram &
+DcfState::GetAccessDelayHistogram (void) const
+{
+  return m_accessDelays;
+}
+Time
+DcfState::GetLastAccessDelay (void) const
+{
+  return m_lastAccessDelay;
+}
+uint64_t
+DcfState::GetBackoffFreezes (void) const
+{
+  return m_backoffFreezes;
+}
+uint64_t
+DcfState::GetCollisions (void) const
+{
+  return m_collisions;
+}
+uint64_t
+DcfState::GetInternalCollisions (void) const
+{
+  return m_internalCollisions;
+}
+void
+DcfState::ResetStatistics (void)
+{
+  m_accessDelays.Reset ();
+  m_backoffFreezes = 0;
+  m_collisions = 0;
+  m_internalCollisions = 0;
+}
 void
 DcfState::NotifyAccessRequested (void)
 {
   m_accessRequested = true;
+  m_accessRequestTime = Simulator::Now ().GetTimeStep ();
 }
 void
 DcfState::NotifyAccessGranted (void)
 {
   NS_ASSERT (m_accessRequested);
   m_accessRequested = false;
+  m_lastAccessDelay = TimeStep (Simulator::Now ().GetTimeStep () - m_accessRequestTime);
+  m_accessDelays.Add (m_lastAccessDelay);
   DoNotifyAccessGranted ();
 }
 void
 DcfState::NotifyCollision (void)
 {
+  m_collisions++;
   DoNotifyCollision ();
 }
 void
 DcfState::NotifyInternalCollision (void)
 {
+  m_internalCollisions++;
   DoNotifyInternalCollision ();
 }
 void
@@ -208,6 +390,10 @@ public:
   {
     m_dcf->NotifyCtsTimeoutResetNow ();
   }
+  virtual void RxIgnored (void)
+  {
+    m_dcf->NotifyRxIgnoredNow ();
+  }
 private:
   ns3::DcfManager *m_dcf;  //!< DcfManager to forward events to
 };
@@ -278,12 +464,20 @@ DcfManager::DcfManager ()
     m_lastSwitchingStart (MicroSeconds (0)),
     m_lastSwitchingDuration (MicroSeconds (0)),
     m_rxing (false),
-    m_slotTimeUs (0),
+    m_rxIgnored (false),
+    m_slotTicks (0),
     m_sifs (Seconds (0.0)),
     m_phyListener (0),
-    m_lowListener (0)
+    m_lowListener (0),
+    m_accessGrantStartValid (false),
+    m_busyPeriods (BUSY_TYPES, DcfHistogram (MicroSeconds (100), 200))
 {
   NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < BUSY_TYPES; i++)
+    {
+      m_busyTime[i] = 0;
+      m_busyEnd[i] = 0;
+    }
 }
 
 DcfManager::~DcfManager ()
@@ -321,19 +515,21 @@ void
 DcfManager::SetSlot (Time slotTime)
 {
   NS_LOG_FUNCTION (this << slotTime);
-  m_slotTimeUs = slotTime.GetMicroSeconds ();
+  m_slotTicks = MicroSeconds (slotTime.GetMicroSeconds ()).GetTimeStep ();
 }
 void
 DcfManager::SetSifs (Time sifs)
 {
   NS_LOG_FUNCTION (this << sifs);
   m_sifs = sifs;
+  InvalidateAccessGrantStart ();
 }
 void
 DcfManager::SetEifsNoDifs (Time eifsNoDifs)
 {
   NS_LOG_FUNCTION (this << eifsNoDifs);
   m_eifsNoDifs = eifsNoDifs;
+  InvalidateAccessGrantStart ();
 }
 Time
 DcfManager::GetEifsNoDifs () const
@@ -342,6 +538,102 @@ DcfManager::GetEifsNoDifs () const
   return m_eifsNoDifs;
 }
 
+void
+DcfManager::SetMediumBusyCallback (MediumBusyCallback callback)
+{
+  NS_LOG_FUNCTION (this << &callback);
+  m_mediumBusyCallback = callback;
+}
+Time
+DcfManager::GetBusyTime (enum BusyType type) const
+{
+  NS_ASSERT (type < BUSY_TYPES);
+  return TimeStep (m_busyTime[type]);
+}
+const DcfHistogram &
+DcfManager::GetBusyPeriodHistogram (enum BusyType type) const
+{
+  NS_ASSERT (type < BUSY_TYPES);
+  return m_busyPeriods[type];
+}
+void
+DcfManager::ResetStatistics (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < BUSY_TYPES; i++)
+    {
+      m_busyTime[i] = 0;
+      m_busyPeriods[i].Reset ();
+    }
+  for (States::const_iterator i = m_states.begin (); i != m_states.end (); i++)
+    {
+      (*i)->ResetStatistics ();
+    }
+}
+
+void
+DcfManager::AddBusyPeriod (enum BusyType type, Time duration)
+{
+  int64_t now = Simulator::Now ().GetTimeStep ();
+  int64_t end = now + duration.GetTimeStep ();
+  int64_t start = std::max (now, m_busyEnd[type]);
+  if (end > start)
+    {
+      m_busyTime[type] += end - start;
+      m_busyEnd[type] = end;
+    }
+  m_busyPeriods[type].Add (duration);
+  if (!m_mediumBusyCallback.IsNull ())
+    {
+      m_mediumBusyCallback (type, duration);
+    }
+}
+void
+DcfManager::TruncateBusyPeriod (enum BusyType type)
+{
+  int64_t now = Simulator::Now ().GetTimeStep ();
+  if (m_busyEnd[type] > now)
+    {
+      m_busyTime[type] -= m_busyEnd[type] - now;
+      m_busyEnd[type] = now;
+      if (!m_mediumBusyCallback.IsNull ())
+        {
+          m_mediumBusyCallback (type, Seconds (0.0));
+        }
+    }
+}
+
+void
+DcfManager::CountIdleSlots (void)
+{
+  int64_t idle = Simulator::Now ().GetTimeStep () - GetAccessGrantStart ().GetTimeStep ();
+  for (States::const_iterator i = m_states.begin (); i != m_states.end (); i++)
+    {
+      DcfState *state = *i;
+      int64_t aifs = state->GetAifsn () * m_slotTicks;
+      if (state->GetIdleSense () && idle >= aifs)
+        {
+          state->NotifyIdleSlots (static_cast<uint32_t> ((idle - aifs) / m_slotTicks));
+        }
+    }
+}
+
+void
+DcfManager::CountBackoffFreezes (void)
+{
+  int64_t now = Simulator::Now ().GetTimeStep ();
+  for (States::const_iterator i = m_states.begin (); i != m_states.end (); i++)
+    {
+      DcfState *state = *i;
+      if (state->IsAccessRequested ()
+          && state->GetBackoffSlots () > 0
+          && GetBackoffStartFor (state) <= now)
+        {
+          state->m_backoffFreezes++;
+        }
+    }
+}
+
 void
 DcfManager::Add (DcfState *dcf)
 {
@@ -449,6 +741,20 @@ DcfManager::RequestAccess (DcfState *state)
   DoRestartAccessTimeoutIfNeeded ();
 }
 
+void
+DcfManager::GrantAccessNow (DcfState *state)
+{
+  NS_LOG_FUNCTION (this << state);
+  UpdateBackoff ();
+  state->m_backoffSlots = 0;
+  state->m_backoffStart = Simulator::Now ().GetTimeStep ();
+  if (!state->IsAccessRequested ())
+    {
+      state->NotifyAccessRequested ();
+    }
+  state->NotifyAccessGranted ();
+}
+
 void
 DcfManager::DoGrantAccess (void)
 {
@@ -458,7 +764,7 @@ DcfManager::DoGrantAccess (void)
     {
       DcfState *state = *i;
       if (state->IsAccessRequested ()
-          && GetBackoffEndFor (state) <= Simulator::Now () )
+          && GetBackoffEndFor (state) <= Simulator::Now ().GetTimeStep ())
         {
           /**
            * This is the first dcf we find with an expired backoff and which
@@ -472,7 +778,7 @@ DcfManager::DoGrantAccess (void)
             {
               DcfState *otherState = *j;
               if (otherState->IsAccessRequested ()
-                  && GetBackoffEndFor (otherState) <= Simulator::Now ())
+                  && GetBackoffEndFor (otherState) <= Simulator::Now ().GetTimeStep ())
                 {
                   MY_DEBUG ("dcf " << k << " needs access. backoff expired. internal collision. slots=" <<
                             otherState->GetBackoffSlots ());
@@ -517,6 +823,10 @@ Time
 DcfManager::GetAccessGrantStart (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_accessGrantStartValid)
+    {
+      return m_accessGrantStart;
+    }
   Time rxAccessStart;
   if (!m_rxing)
     {
@@ -549,42 +859,50 @@ DcfManager::GetAccessGrantStart (void) const
                ", busy access start=" << busyAccessStart <<
                ", tx access start=" << txAccessStart <<
                ", nav access start=" << navAccessStart);
+  m_accessGrantStart = accessGrantedStart;
+  m_accessGrantStartValid = true;
   return accessGrantedStart;
 }
 
-Time
+void
+DcfManager::InvalidateAccessGrantStart (void)
+{
+  m_accessGrantStartValid = false;
+}
+
+int64_t
 DcfManager::GetBackoffStartFor (DcfState *state)
 {
   NS_LOG_FUNCTION (this << state);
-  Time mostRecentEvent = MostRecent (state->GetBackoffStart (),
-                                     GetAccessGrantStart () + MicroSeconds (state->GetAifsn () * m_slotTimeUs));
+  int64_t mostRecentEvent = std::max (state->GetBackoffStart (),
+                                      GetAccessGrantStart ().GetTimeStep () + state->GetAifsn () * m_slotTicks);
 
   return mostRecentEvent;
 }
 
-Time
+int64_t
 DcfManager::GetBackoffEndFor (DcfState *state)
 {
-  return GetBackoffStartFor (state) + MicroSeconds (state->GetBackoffSlots () * m_slotTimeUs);
+  return GetBackoffStartFor (state) + state->GetBackoffSlots () * m_slotTicks;
 }
 
 void
 DcfManager::UpdateBackoff (void)
 {
   NS_LOG_FUNCTION (this);
+  int64_t now = Simulator::Now ().GetTimeStep ();
   uint32_t k = 0;
   for (States::const_iterator i = m_states.begin (); i != m_states.end (); i++, k++)
     {
       DcfState *state = *i;
 
-      Time backoffStart = GetBackoffStartFor (state);
-      if (backoffStart <= Simulator::Now ())
+      int64_t backoffStart = GetBackoffStartFor (state);
+      if (backoffStart <= now)
         {
-          uint32_t nus = (Simulator::Now () - backoffStart).GetMicroSeconds ();
-          uint32_t nIntSlots = nus / m_slotTimeUs;
-          uint32_t n = std::min (nIntSlots, state->GetBackoffSlots ());
+          int64_t nIntSlots = (now - backoffStart) / m_slotTicks;
+          uint32_t n = static_cast<uint32_t> (std::min (nIntSlots, static_cast<int64_t> (state->GetBackoffSlots ())));
           MY_DEBUG ("dcf " << k << " dec backoff slots=" << n);
-          Time backoffUpdateBound = backoffStart + MicroSeconds (n * m_slotTimeUs);
+          int64_t backoffUpdateBound = backoffStart + n * m_slotTicks;
           state->UpdateBackoffSlotsNow (n, backoffUpdateBound);
         }
     }
@@ -599,14 +917,15 @@ DcfManager::DoRestartAccessTimeoutIfNeeded (void)
    * if there is one, how many slots for AIFS+backoff does it require ?
    */
   bool accessTimeoutNeeded = false;
-  Time expectedBackoffEnd = Simulator::GetMaximumSimulationTime ();
+  int64_t now = Simulator::Now ().GetTimeStep ();
+  int64_t expectedBackoffEnd = Simulator::GetMaximumSimulationTime ().GetTimeStep ();
   for (States::const_iterator i = m_states.begin (); i != m_states.end (); i++)
     {
       DcfState *state = *i;
       if (state->IsAccessRequested ())
         {
-          Time tmp = GetBackoffEndFor (state);
-          if (tmp > Simulator::Now ())
+          int64_t tmp = GetBackoffEndFor (state);
+          if (tmp > now)
             {
               accessTimeoutNeeded = true;
               expectedBackoffEnd = std::min (expectedBackoffEnd, tmp);
@@ -616,7 +935,7 @@ DcfManager::DoRestartAccessTimeoutIfNeeded (void)
   if (accessTimeoutNeeded)
     {
       MY_DEBUG ("expected backoff end=" << expectedBackoffEnd);
-      Time expectedBackoffDelay = expectedBackoffEnd - Simulator::Now ();
+      Time expectedBackoffDelay = TimeStep (expectedBackoffEnd - now);
       if (m_accessTimeout.IsRunning ()
           && Simulator::GetDelayLeft (m_accessTimeout) > expectedBackoffDelay)
         {
@@ -636,27 +955,64 @@ DcfManager::NotifyRxStartNow (Time duration)
   NS_LOG_FUNCTION (this << duration);
   MY_DEBUG ("rx start for=" << duration);
   UpdateBackoff ();
+  CountBackoffFreezes ();
+  CountIdleSlots ();
+  AddBusyPeriod (BUSY_RX, duration);
   m_lastRxStart = Simulator::Now ();
   m_lastRxDuration = duration;
   m_rxing = true;
+  m_rxIgnored = false;
+  InvalidateAccessGrantStart ();
+}
+void
+DcfManager::NotifyRxIgnoredNow (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_rxing)
+    {
+      return;
+    }
+  MY_DEBUG ("rx ignored");
+  UpdateBackoff ();
+  // the medium is idle from now on, as if the frame had ended well
+  TruncateBusyPeriod (BUSY_RX);
+  m_lastRxEnd = Simulator::Now ();
+  m_lastRxDuration = m_lastRxEnd - m_lastRxStart;
+  m_lastRxReceivedOk = true;
+  m_rxing = false;
+  m_rxIgnored = true;
+  InvalidateAccessGrantStart ();
+  DoRestartAccessTimeoutIfNeeded ();
 }
 void
 DcfManager::NotifyRxEndOkNow (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_rxIgnored)
+    {
+      m_rxIgnored = false;
+      return;
+    }
   MY_DEBUG ("rx end ok");
   m_lastRxEnd = Simulator::Now ();
   m_lastRxReceivedOk = true;
   m_rxing = false;
+  InvalidateAccessGrantStart ();
 }
 void
 DcfManager::NotifyRxEndErrorNow (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_rxIgnored)
+    {
+      m_rxIgnored = false;
+      return;
+    }
   MY_DEBUG ("rx end error");
   m_lastRxEnd = Simulator::Now ();
   m_lastRxReceivedOk = false;
   m_rxing = false;
+  InvalidateAccessGrantStart ();
 }
 void
 DcfManager::NotifyTxStartNow (Time duration)
@@ -668,15 +1024,23 @@ DcfManager::NotifyTxStartNow (Time duration)
       //inside SIFS, so, we check that lastRxStart was maximum a SIFS
       //ago
       NS_ASSERT (Simulator::Now () - m_lastRxStart <= m_sifs);
+      TruncateBusyPeriod (BUSY_RX);
       m_lastRxEnd = Simulator::Now ();
       m_lastRxDuration = m_lastRxEnd - m_lastRxStart;
       m_lastRxReceivedOk = true;
       m_rxing = false;
+      InvalidateAccessGrantStart ();
     }
+  // an ignored reception is aborted by our transmission
+  m_rxIgnored = false;
   MY_DEBUG ("tx start for " << duration);
   UpdateBackoff ();
+  CountBackoffFreezes ();
+  CountIdleSlots ();
+  AddBusyPeriod (BUSY_TX, duration);
   m_lastTxStart = Simulator::Now ();
   m_lastTxDuration = duration;
+  InvalidateAccessGrantStart ();
 }
 void
 DcfManager::NotifyMaybeCcaBusyStartNow (Time duration)
@@ -684,8 +1048,11 @@ DcfManager::NotifyMaybeCcaBusyStartNow (Time duration)
   NS_LOG_FUNCTION (this << duration);
   MY_DEBUG ("busy start for " << duration);
   UpdateBackoff ();
+  CountBackoffFreezes ();
+  AddBusyPeriod (BUSY_CCA, duration);
   m_lastBusyStart = Simulator::Now ();
   m_lastBusyDuration = duration;
+  InvalidateAccessGrantStart ();
 }
 
 
@@ -705,6 +1072,7 @@ DcfManager::NotifySwitchingStartNow (Time duration)
       m_lastRxReceivedOk = true;
       m_rxing = false;
     }
+  m_rxIgnored = false;
   if (m_lastNavStart + m_lastNavDuration > now)
     {
       m_lastNavDuration = now - m_lastNavStart;
@@ -721,6 +1089,11 @@ DcfManager::NotifySwitchingStartNow (Time duration)
     {
       m_lastCtsTimeoutEnd = now;
     }
+  InvalidateAccessGrantStart ();
+  for (uint32_t i = 0; i < BUSY_TYPES; i++)
+    {
+      TruncateBusyPeriod (static_cast<enum BusyType> (i));
+    }
 
   // Cancel timeout
   if (m_accessTimeout.IsRunning ())
@@ -735,7 +1108,7 @@ DcfManager::NotifySwitchingStartNow (Time duration)
       uint32_t remainingSlots = state->GetBackoffSlots ();
       if (remainingSlots > 0)
         {
-          state->UpdateBackoffSlotsNow (remainingSlots, now);
+          state->UpdateBackoffSlotsNow (remainingSlots, now.GetTimeStep ());
           NS_ASSERT (state->GetBackoffSlots () == 0);
         }
       state->ResetCw ();
@@ -746,6 +1119,7 @@ DcfManager::NotifySwitchingStartNow (Time duration)
   MY_DEBUG ("switching start for " << duration);
   m_lastSwitchingStart = Simulator::Now ();
   m_lastSwitchingDuration = duration;
+  InvalidateAccessGrantStart ();
 
 }
 
@@ -755,8 +1129,14 @@ DcfManager::NotifyNavResetNow (Time duration)
   NS_LOG_FUNCTION (this << duration);
   MY_DEBUG ("nav reset for=" << duration);
   UpdateBackoff ();
+  TruncateBusyPeriod (BUSY_NAV);
+  if (duration.IsStrictlyPositive ())
+    {
+      AddBusyPeriod (BUSY_NAV, duration);
+    }
   m_lastNavStart = Simulator::Now ();
   m_lastNavDuration = duration;
+  InvalidateAccessGrantStart ();
   UpdateBackoff ();
   /**
    * If the nav reset indicates an end-of-nav which is earlier
@@ -777,8 +1157,11 @@ DcfManager::NotifyNavStartNow (Time duration)
   Time lastNavEnd = m_lastNavStart + m_lastNavDuration;
   if (newNavEnd > lastNavEnd)
     {
+      CountBackoffFreezes ();
+      AddBusyPeriod (BUSY_NAV, duration);
       m_lastNavStart = Simulator::Now ();
       m_lastNavDuration = duration;
+      InvalidateAccessGrantStart ();
     }
 }
 void
@@ -787,12 +1170,14 @@ DcfManager::NotifyAckTimeoutStartNow (Time duration)
   NS_LOG_FUNCTION (this << duration);
   NS_ASSERT (m_lastAckTimeoutEnd < Simulator::Now ());
   m_lastAckTimeoutEnd = Simulator::Now () + duration;
+  InvalidateAccessGrantStart ();
 }
 void
 DcfManager::NotifyAckTimeoutResetNow ()
 {
   NS_LOG_FUNCTION (this);
   m_lastAckTimeoutEnd = Simulator::Now ();
+  InvalidateAccessGrantStart ();
   DoRestartAccessTimeoutIfNeeded ();
 }
 void
@@ -800,12 +1185,14 @@ DcfManager::NotifyCtsTimeoutStartNow (Time duration)
 {
   NS_LOG_FUNCTION (this << duration);
   m_lastCtsTimeoutEnd = Simulator::Now () + duration;
+  InvalidateAccessGrantStart ();
 }
 void
 DcfManager::NotifyCtsTimeoutResetNow ()
 {
   NS_LOG_FUNCTION (this);
   m_lastCtsTimeoutEnd = Simulator::Now ();
+  InvalidateAccessGrantStart ();
   DoRestartAccessTimeoutIfNeeded ();
 }
 } // namespace ns3
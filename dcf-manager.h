@@ -23,6 +23,7 @@
 
 #include "ns3/nstime.h"
 #include "ns3/event-id.h"
+#include "ns3/callback.h"
 #include <vector>
 
 namespace ns3 {
@@ -33,6 +34,59 @@ class MacLow;
 class PhyListener;
 class LowDcfListener;
 
+/**
+ * \brief a histogram of durations with fixed-width buckets
+ * \ingroup wifi
+ *
+ * Durations longer than the range of the histogram are counted in
+ * the last bucket.
+ */
+class DcfHistogram
+{
+public:
+  /**
+   * \param bucketWidth the width of each bucket
+   * \param nBuckets the number of buckets
+   */
+  DcfHistogram (Time bucketWidth, uint32_t nBuckets);
+
+  /**
+   * \param duration a new sample
+   */
+  void Add (Time duration);
+  /**
+   * Remove all samples.
+   */
+  void Reset (void);
+  /**
+   * \return the width of each bucket
+   */
+  Time GetBucketWidth (void) const;
+  /**
+   * \return the number of buckets
+   */
+  uint32_t GetNBuckets (void) const;
+  /**
+   * \param bucket the index of a bucket
+   * \return the number of samples in this bucket
+   */
+  uint64_t GetBucketCount (uint32_t bucket) const;
+  /**
+   * \return the total number of samples
+   */
+  uint64_t GetCount (void) const;
+  /**
+   * \return the sum of all samples
+   */
+  Time GetSum (void) const;
+
+private:
+  int64_t m_bucketWidth; //!< in time steps
+  std::vector<uint64_t> m_buckets;
+  uint64_t m_count;
+  int64_t m_sum;         //!< in time steps
+};
+
 /**
  * \brief keep track of the state needed for a single DCF
  * function.
@@ -87,6 +141,32 @@ public:
    * \return the maximum congestion window size
    */
   uint32_t GetCwMax (void) const;
+  /**
+   * \param enable whether the CW is adapted with Idle Sense instead of
+   *        binary exponential backoff.
+   *
+   * With Idle Sense, the station measures the mean number of idle
+   * slots between the transmissions it observes on the medium. Every
+   * few transmissions, the CW is increased additively if this mean is
+   * below the target, and decreased multiplicatively otherwise. The CW
+   * is then left untouched by ResetCw and UpdateFailedCw, apart from
+   * being kept within [minCW, maxCW].
+   */
+  void SetIdleSense (bool enable);
+  /**
+   * \return true if the CW is adapted with Idle Sense, false otherwise
+   */
+  bool GetIdleSense (void) const;
+  /**
+   * \param target the mean number of idle slots between transmissions
+   *        that Idle Sense aims at
+   */
+  void SetIdleSenseTarget (double target);
+  /**
+   * \return the mean number of idle slots between transmissions that
+   *         Idle Sense aims at
+   */
+  double GetIdleSenseTarget (void) const;
   /**
    * Update the value of the CW variable to take into account
    * a transmission success or a transmission abort (stop transmission
@@ -107,6 +187,13 @@ public:
    * slots specified.
    */
   void StartBackoffNow (uint32_t nSlots);
+  /**
+   * \param nSlots the number of slots of the backoff.
+   *
+   * Start a new backoff even if the previous one has not expired. Must
+   * not be called while access is requested.
+   */
+  void RestartBackoffNow (uint32_t nSlots);
   /**
    * \returns the current value of the CW variable. The initial value is
    * minCW.
@@ -118,6 +205,36 @@ public:
    */
   bool IsAccessRequested (void) const;
 
+  /**
+   * \returns the histogram of the delays between an access request
+   *          and the corresponding access grant.
+   */
+  const DcfHistogram & GetAccessDelayHistogram (void) const;
+  /**
+   * \returns the delay between the last access request and the
+   *          corresponding access grant.
+   */
+  Time GetLastAccessDelay (void) const;
+  /**
+   * \returns the number of times the backoff countdown was frozen
+   *          because the medium became busy.
+   */
+  uint64_t GetBackoffFreezes (void) const;
+  /**
+   * \returns the number of times the medium was found busy when
+   *          access was requested (see DoNotifyCollision).
+   */
+  uint64_t GetCollisions (void) const;
+  /**
+   * \returns the number of internal collisions (see
+   *          DoNotifyInternalCollision).
+   */
+  uint64_t GetInternalCollisions (void) const;
+  /**
+   * Reset the access delay histogram and all counters.
+   */
+  void ResetStatistics (void);
+
 private:
   friend class DcfManager;
 
@@ -130,16 +247,23 @@ private:
   /**
    * Return the time when the backoff procedure started.
    *
-   * \return the time when the backoff procedure started
+   * \return the time when the backoff procedure started, in time steps
    */
-  Time GetBackoffStart (void) const;
+  int64_t GetBackoffStart (void) const;
   /**
    * Update backoff slots that nSlots has passed.
    *
    * \param nSlots
-   * \param backoffUpdateBound
+   * \param backoffUpdateBound the end of the last slot counted, in time steps
    */
-  void UpdateBackoffSlotsNow (uint32_t nSlots, Time backoffUpdateBound);
+  void UpdateBackoffSlotsNow (uint32_t nSlots, int64_t backoffUpdateBound);
+  /**
+   * Notify that a transmission started on the medium after nSlots idle
+   * slots. Only used by Idle Sense.
+   *
+   * \param nSlots the number of idle slots since the end of AIFS
+   */
+  void NotifyIdleSlots (uint32_t nSlots);
   /**
    * Notify that access request has been received.
    */
@@ -203,12 +327,26 @@ private:
   uint32_t m_backoffSlots;
   // the backoffStart variable is used to keep track of the
   // time at which a backoff was started or the time at which
-  // the backoff counter was last updated.
-  Time m_backoffStart;
+  // the backoff counter was last updated. It is kept in time steps
+  // (see Time::GetTimeStep) like all the backoff arithmetic.
+  int64_t m_backoffStart;
   uint32_t m_cwMin;
   uint32_t m_cwMax;
   uint32_t m_cw;
   bool m_accessRequested;
+
+  int64_t m_accessRequestTime; //!< in time steps
+  Time m_lastAccessDelay;
+  DcfHistogram m_accessDelays;
+  uint64_t m_backoffFreezes;
+  uint64_t m_collisions;
+  uint64_t m_internalCollisions;
+
+  bool m_idleSense;
+  double m_idleSenseTarget;
+  double m_idleSenseCw;              //!< unrounded CW computed by Idle Sense
+  uint32_t m_idleSenseTransmissions; //!< transmissions observed since the last CW update
+  uint32_t m_idleSenseSlots;         //!< idle slots observed since the last CW update
 };
 
 /**
@@ -229,6 +367,24 @@ private:
 class DcfManager
 {
 public:
+  /**
+   * The causes of a busy medium whose duration is accounted for.
+   */
+  enum BusyType
+  {
+    BUSY_RX,
+    BUSY_TX,
+    BUSY_NAV,
+    BUSY_CCA,
+    BUSY_TYPES
+  };
+  /**
+   * Callback invoked when a busy period starts, with its cause and its
+   * expected duration. A zero duration means that the busy period of
+   * this cause ended earlier than expected.
+   */
+  typedef Callback<void, enum BusyType, Time> MediumBusyCallback;
+
   DcfManager ();
   ~DcfManager ();
 
@@ -294,6 +450,15 @@ public:
    * is granted if it ever gets granted.
    */
   void RequestAccess (DcfState *state);
+  /**
+   * \param state a DcfState
+   *
+   * Grant access to the medium to a specific DcfState right now,
+   * whether it requested access or not, and without waiting for the end
+   * of its backoff, which is forfeited. This is used when the medium is
+   * handed over to us, for example by a CF-Poll from the AP.
+   */
+  void GrantAccessNow (DcfState *state);
 
   /**
    * \param duration expected duration of reception
@@ -312,6 +477,13 @@ public:
    * completed unsuccessfully.
    */
   void NotifyRxEndErrorNow (void);
+  /**
+   * Notify the DCF that the packet being received comes from an
+   * overlapping BSS and is ignored: the medium is idle from now on, and
+   * the end of this reception, whether successful or not, is not
+   * taken into account.
+   */
+  void NotifyRxIgnoredNow (void);
   /**
    * \param duration expected duration of transmission
    *
@@ -366,7 +538,58 @@ public:
    * Notify that CTS timer has resetted.
    */
   void NotifyCtsTimeoutResetNow ();
+
+  /**
+   * \param callback the callback to invoke when the medium becomes busy
+   */
+  void SetMediumBusyCallback (MediumBusyCallback callback);
+  /**
+   * \param type a cause of busy medium
+   * \return the total time the medium was busy because of this cause.
+   *
+   * Overlapping busy periods of the same cause are counted once;
+   * busy periods of different causes can overlap.
+   */
+  Time GetBusyTime (enum BusyType type) const;
+  /**
+   * \param type a cause of busy medium
+   * \return the histogram of the expected durations of the busy
+   *         periods of this cause
+   */
+  const DcfHistogram & GetBusyPeriodHistogram (enum BusyType type) const;
+  /**
+   * Reset the busy time statistics.
+   */
+  void ResetStatistics (void);
 private:
+  /**
+   * Account for a busy period starting now.
+   *
+   * \param type the cause of the busy period
+   * \param duration its expected duration
+   */
+  void AddBusyPeriod (enum BusyType type, Time duration);
+  /**
+   * Account for the end, now, of the busy period in progress, if any,
+   * which is shorter than expected.
+   *
+   * \param type the cause of the busy period
+   */
+  void TruncateBusyPeriod (enum BusyType type);
+  /**
+   * Count a backoff freeze for each DcfState whose backoff is counting
+   * down. Must be called when the medium becomes busy, before the
+   * state of the DcfManager is updated.
+   */
+  void CountBackoffFreezes (void);
+  /**
+   * Report the number of idle slots since the medium became idle to
+   * each DcfState using Idle Sense. Must be called when a transmission
+   * starts on the medium, before the state of the DcfManager is updated.
+   * Frames sent less than AIFS after the medium became idle belong to
+   * the same exchange as the previous one and are not reported.
+   */
+  void CountIdleSlots (void);
   /**
    * Update backoff slots for all DcfStates.
    */
@@ -429,24 +652,33 @@ private:
    *
    * \returns the absolute time at which access could start to
    * be granted
+   *
+   * The value only depends on the last PHY, NAV and timeout events,
+   * so it is computed once and cached until one of them changes.
    */
   Time GetAccessGrantStart (void) const;
+  /**
+   * Discard the cached access grant start. Must be called whenever
+   * one of the values GetAccessGrantStart depends on is modified.
+   */
+  void InvalidateAccessGrantStart (void);
   /**
    * Return the time when the backoff procedure
    * started for the given DcfState.
    *
    * \param state
-   * \return the time when the backoff procedure started
+   * \return the time when the backoff procedure started, in time steps
    */
-  Time GetBackoffStartFor (DcfState *state);
+  int64_t GetBackoffStartFor (DcfState *state);
   /**
    * Return the time when the backoff procedure
    * ended (or will ended) for the given DcfState.
    *
    * \param state
-   * \return the time when the backoff procedure ended (or will ended)
+   * \return the time when the backoff procedure ended (or will ended),
+   *         in time steps
    */
-  Time GetBackoffEndFor (DcfState *state);
+  int64_t GetBackoffEndFor (DcfState *state);
   void DoRestartAccessTimeoutIfNeeded (void);
   /**
    * Called when access timeout should occur
@@ -487,12 +719,20 @@ private:
   Time m_lastSwitchingStart;
   Time m_lastSwitchingDuration;
   bool m_rxing;
+  bool m_rxIgnored; //!< whether the end of the current reception must be ignored
   Time m_eifsNoDifs;
   EventId m_accessTimeout;
-  uint32_t m_slotTimeUs;
+  int64_t m_slotTicks; //!< the slot duration, rounded to the microsecond, in time steps
   Time m_sifs;
   PhyListener* m_phyListener;
   LowDcfListener* m_lowListener;
+  mutable Time m_accessGrantStart;     //!< cached result of GetAccessGrantStart
+  mutable bool m_accessGrantStartValid; //!< whether m_accessGrantStart is up to date
+
+  int64_t m_busyTime[BUSY_TYPES]; //!< accumulated busy time per cause, in time steps
+  int64_t m_busyEnd[BUSY_TYPES];  //!< end of the last busy period per cause, in time steps
+  std::vector<DcfHistogram> m_busyPeriods;
+  MediumBusyCallback m_mediumBusyCallback;
 };
 
 } // namespace ns3
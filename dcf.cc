@@ -19,7 +19,10 @@
  */
 #include "dcf.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
 #include "ns3/log.h"
+#include "ns3/trace-source-accessor.h"
 
 NS_LOG_COMPONENT_DEFINE ("Dcf");
 
@@ -48,6 +51,23 @@ Dcf::GetTypeId (void)
                    MakeUintegerAccessor (&Dcf::SetAifsn,
                                          &Dcf::GetAifsn),
                    MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("IdleSense", "If true, adapt the contention window with Idle Sense instead of binary exponential backoff.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&Dcf::SetIdleSense,
+                                        &Dcf::GetIdleSense),
+                   MakeBooleanChecker ())
+    .AddAttribute ("IdleSenseTarget", "The mean number of idle slots between transmissions that Idle Sense aims at. "
+                   "The default value is the one computed for 802.11g.",
+                   DoubleValue (3.91),
+                   MakeDoubleAccessor (&Dcf::SetIdleSenseTarget,
+                                       &Dcf::GetIdleSenseTarget),
+                   MakeDoubleChecker<double> (0.0))
+    .AddTraceSource ("AccessDelay",
+                     "Access to the medium was granted, after this delay since it was requested.",
+                     MakeTraceSourceAccessor (&Dcf::m_accessDelayTrace))
+    .AddTraceSource ("Collision",
+                     "The medium was busy when access was requested (false), or an internal collision occurred (true).",
+                     MakeTraceSourceAccessor (&Dcf::m_collisionTrace))
   ;
   return tid;
 }
@@ -22,9 +22,13 @@
 #define DCF_H
 
 #include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
 
 namespace ns3 {
 
+class DcfState;
+
 /**
  * \ingroup wifi
  *
@@ -71,6 +75,46 @@ public:
    * \return the number of slots that make up an AIFS
    */
   virtual uint32_t GetAifsn (void) const = 0;
+  /**
+   * \param enable whether the contention window is adapted with Idle
+   *        Sense instead of binary exponential backoff
+   *
+   * \sa DcfState::SetIdleSense
+   */
+  virtual void SetIdleSense (bool enable) = 0;
+  /**
+   * \return true if the contention window is adapted with Idle Sense
+   */
+  virtual bool GetIdleSense (void) const = 0;
+  /**
+   * \param target the mean number of idle slots between transmissions
+   *        that Idle Sense aims at
+   */
+  virtual void SetIdleSenseTarget (double target) = 0;
+  /**
+   * \return the mean number of idle slots between transmissions that
+   *         Idle Sense aims at
+   */
+  virtual double GetIdleSenseTarget (void) const = 0;
+  /**
+   * Return the DcfState registered in the DcfManager, which holds the
+   * channel access statistics of this DCF.
+   *
+   * \return the DcfState of this DCF
+   */
+  virtual const DcfState * GetDcfState (void) const = 0;
+
+protected:
+  /**
+   * The trace source fired when access to the medium is granted, with
+   * the delay since access was requested.
+   */
+  TracedCallback<Time> m_accessDelayTrace;
+  /**
+   * The trace source fired when the medium is found busy when access is
+   * requested (false), or on an internal collision (true).
+   */
+  TracedCallback<bool> m_collisionTrace;
 };
 
 } // namespace ns3
@@ -53,14 +53,17 @@ public:
 private:
   virtual void DoNotifyAccessGranted (void)
   {
+    m_txop->m_accessDelayTrace (GetLastAccessDelay ());
     m_txop->NotifyAccessGranted ();
   }
   virtual void DoNotifyInternalCollision (void)
   {
+    m_txop->m_collisionTrace (true);
     m_txop->NotifyInternalCollision ();
   }
   virtual void DoNotifyCollision (void)
   {
+    m_txop->m_collisionTrace (false);
     m_txop->NotifyCollision ();
   }
   virtual void DoNotifyChannelSwitching (void)
@@ -312,6 +315,41 @@ EdcaTxopN::GetAifsn (void) const
   return m_dcf->GetAifsn ();
 }
 
+void
+EdcaTxopN::SetIdleSense (bool enable)
+{
+  NS_LOG_FUNCTION (this << enable);
+  m_dcf->SetIdleSense (enable);
+}
+
+bool
+EdcaTxopN::GetIdleSense (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_dcf->GetIdleSense ();
+}
+
+void
+EdcaTxopN::SetIdleSenseTarget (double target)
+{
+  NS_LOG_FUNCTION (this << target);
+  m_dcf->SetIdleSenseTarget (target);
+}
+
+double
+EdcaTxopN::GetIdleSenseTarget (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_dcf->GetIdleSenseTarget ();
+}
+
+const DcfState *
+EdcaTxopN::GetDcfState (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_dcf;
+}
+
 void
 EdcaTxopN::SetTxMiddle (MacTxMiddle *txMiddle)
 {
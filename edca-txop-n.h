@@ -154,6 +154,11 @@ public:
   virtual uint32_t GetMinCw (void) const;
   virtual uint32_t GetMaxCw (void) const;
   virtual uint32_t GetAifsn (void) const;
+  virtual void SetIdleSense (bool enable);
+  virtual bool GetIdleSense (void) const;
+  virtual void SetIdleSenseTarget (double target);
+  virtual double GetIdleSenseTarget (void) const;
+  virtual const DcfState * GetDcfState (void) const;
 
   /**
    * Return the MacLow associated with this EdcaTxopN.
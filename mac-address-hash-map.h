@@ -0,0 +1,347 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef MAC_ADDRESS_HASH_MAP_H
+#define MAC_ADDRESS_HASH_MAP_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/mac48-address.h"
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ * \brief a hash table keyed by a packed MAC address and TID
+ *
+ * Keys are 64-bit integers built by GetKey: the 48 bits of the address
+ * followed by an 8-bit TID. While the table holds at most SMALL_SIZE
+ * entries, they live in an inline array that is scanned linearly; this
+ * covers the common case of a station with a single peer. Larger tables
+ * switch to open addressing with linear probing, so that the lookup cost
+ * does not depend on the number of entries.
+ *
+ * Values are allocated on the heap: the pointers returned by Find and
+ * Insert remain valid until the entry is erased, even if the table grows.
+ */
+template <typename T>
+class MacAddressHashMap
+{
+public:
+  MacAddressHashMap ();
+  ~MacAddressHashMap ();
+
+  /**
+   * \param address the MAC address
+   * \return the key associated to the address alone
+   */
+  static uint64_t GetKey (Mac48Address address);
+  /**
+   * \param address the MAC address
+   * \param tid the traffic ID
+   * \return the key associated to the (address, tid) pair
+   */
+  static uint64_t GetKey (Mac48Address address, uint8_t tid);
+
+  /**
+   * \param key the key to look for
+   * \return a pointer to the value stored for this key, or 0 if there is none
+   */
+  T * Find (uint64_t key) const;
+  /**
+   * \param key the key of the new entry
+   * \param value the value of the new entry
+   * \return a pointer to the stored value
+   *
+   * If an entry already exists for this key, it is left untouched and a
+   * pointer to it is returned, like std::map::insert.
+   */
+  T * Insert (uint64_t key, const T &value);
+  /**
+   * \param key the key of the entry to remove
+   * \return true if an entry was removed, false otherwise
+   */
+  bool Erase (uint64_t key);
+  /**
+   * Remove all entries.
+   */
+  void Clear (void);
+  /**
+   * \return the number of entries in the table
+   */
+  uint32_t GetSize (void) const;
+
+private:
+  /**
+   * Copying is not supported: the table owns its values.
+   */
+  MacAddressHashMap (const MacAddressHashMap &o);
+  MacAddressHashMap & operator = (const MacAddressHashMap &o);
+
+  enum
+  {
+    SMALL_SIZE = 4,
+    INITIAL_CAPACITY = 16
+  };
+  enum SlotState
+  {
+    SLOT_EMPTY,
+    SLOT_FULL,
+    SLOT_DELETED
+  };
+  struct Slot
+  {
+    uint64_t key;
+    T *value;
+    enum SlotState state;
+  };
+
+  uint32_t GetBucket (uint64_t key) const;
+  void Rehash (uint32_t capacity);
+
+  Slot m_small[SMALL_SIZE];
+  std::vector<Slot> m_slots; //!< empty as long as the inline array is used
+  uint32_t m_size;
+  uint32_t m_deleted;
+  uint32_t m_mask;
+};
+
+} // namespace ns3
+
+namespace ns3 {
+
+template <typename T>
+MacAddressHashMap<T>::MacAddressHashMap ()
+  : m_size (0),
+    m_deleted (0),
+    m_mask (0)
+{
+}
+
+template <typename T>
+MacAddressHashMap<T>::~MacAddressHashMap ()
+{
+  Clear ();
+}
+
+template <typename T>
+uint64_t
+MacAddressHashMap<T>::GetKey (Mac48Address address)
+{
+  return GetKey (address, 0);
+}
+
+template <typename T>
+uint64_t
+MacAddressHashMap<T>::GetKey (Mac48Address address, uint8_t tid)
+{
+  uint8_t buffer[6];
+  address.CopyTo (buffer);
+  uint64_t key = 0;
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      key = (key << 8) | buffer[i];
+    }
+  return (key << 8) | tid;
+}
+
+template <typename T>
+uint32_t
+MacAddressHashMap<T>::GetBucket (uint64_t key) const
+{
+  // Fibonacci hashing: the high bits of the product are well mixed even
+  // when only the low bytes of the addresses differ.
+  uint64_t h = key * 0x9e3779b97f4a7c15ULL;
+  return static_cast<uint32_t> (h >> 32) & m_mask;
+}
+
+template <typename T>
+T *
+MacAddressHashMap<T>::Find (uint64_t key) const
+{
+  if (m_slots.empty ())
+    {
+      for (uint32_t i = 0; i < m_size; i++)
+        {
+          if (m_small[i].key == key)
+            {
+              return m_small[i].value;
+            }
+        }
+      return 0;
+    }
+  uint32_t i = GetBucket (key);
+  while (m_slots[i].state != SLOT_EMPTY)
+    {
+      if (m_slots[i].state == SLOT_FULL && m_slots[i].key == key)
+        {
+          return m_slots[i].value;
+        }
+      i = (i + 1) & m_mask;
+    }
+  return 0;
+}
+
+template <typename T>
+T *
+MacAddressHashMap<T>::Insert (uint64_t key, const T &value)
+{
+  T *existing = Find (key);
+  if (existing != 0)
+    {
+      return existing;
+    }
+  if (m_slots.empty ())
+    {
+      if (m_size < SMALL_SIZE)
+        {
+          m_small[m_size].key = key;
+          m_small[m_size].value = new T (value);
+          m_small[m_size].state = SLOT_FULL;
+          m_size++;
+          return m_small[m_size - 1].value;
+        }
+      Rehash (INITIAL_CAPACITY);
+    }
+  else if ((m_size + m_deleted + 1) * 4 > (m_mask + 1) * 3)
+    {
+      // grow only if live entries are the problem, otherwise just drop tombstones
+      Rehash ((m_size + 1) * 2 > m_mask + 1 ? (m_mask + 1) * 2 : m_mask + 1);
+    }
+  uint32_t i = GetBucket (key);
+  while (m_slots[i].state == SLOT_FULL)
+    {
+      i = (i + 1) & m_mask;
+    }
+  if (m_slots[i].state == SLOT_DELETED)
+    {
+      m_deleted--;
+    }
+  m_slots[i].key = key;
+  m_slots[i].value = new T (value);
+  m_slots[i].state = SLOT_FULL;
+  m_size++;
+  return m_slots[i].value;
+}
+
+template <typename T>
+bool
+MacAddressHashMap<T>::Erase (uint64_t key)
+{
+  if (m_slots.empty ())
+    {
+      for (uint32_t i = 0; i < m_size; i++)
+        {
+          if (m_small[i].key == key)
+            {
+              delete m_small[i].value;
+              m_small[i] = m_small[m_size - 1];
+              m_size--;
+              return true;
+            }
+        }
+      return false;
+    }
+  uint32_t i = GetBucket (key);
+  while (m_slots[i].state != SLOT_EMPTY)
+    {
+      if (m_slots[i].state == SLOT_FULL && m_slots[i].key == key)
+        {
+          delete m_slots[i].value;
+          m_slots[i].value = 0;
+          m_slots[i].state = SLOT_DELETED;
+          m_size--;
+          m_deleted++;
+          return true;
+        }
+      i = (i + 1) & m_mask;
+    }
+  return false;
+}
+
+template <typename T>
+void
+MacAddressHashMap<T>::Clear (void)
+{
+  if (m_slots.empty ())
+    {
+      for (uint32_t i = 0; i < m_size; i++)
+        {
+          delete m_small[i].value;
+        }
+    }
+  else
+    {
+      for (uint32_t i = 0; i < m_slots.size (); i++)
+        {
+          if (m_slots[i].state == SLOT_FULL)
+            {
+              delete m_slots[i].value;
+            }
+        }
+      m_slots.clear ();
+    }
+  m_size = 0;
+  m_deleted = 0;
+  m_mask = 0;
+}
+
+template <typename T>
+uint32_t
+MacAddressHashMap<T>::GetSize (void) const
+{
+  return m_size;
+}
+
+template <typename T>
+void
+MacAddressHashMap<T>::Rehash (uint32_t capacity)
+{
+  NS_ASSERT ((capacity & (capacity - 1)) == 0);
+  std::vector<Slot> old;
+  if (m_slots.empty ())
+    {
+      old.assign (m_small, m_small + m_size);
+    }
+  else
+    {
+      old.swap (m_slots);
+    }
+  Slot empty;
+  empty.key = 0;
+  empty.value = 0;
+  empty.state = SLOT_EMPTY;
+  m_slots.assign (capacity, empty);
+  m_mask = capacity - 1;
+  m_deleted = 0;
+  for (typename std::vector<Slot>::const_iterator j = old.begin (); j != old.end (); j++)
+    {
+      if (j->state != SLOT_FULL)
+        {
+          continue;
+        }
+      uint32_t i = GetBucket (j->key);
+      while (m_slots[i].state == SLOT_FULL)
+        {
+          i = (i + 1) & m_mask;
+        }
+      m_slots[i] = *j;
+    }
+}
+
+} // namespace ns3
+
+#endif /* MAC_ADDRESS_HASH_MAP_H */
@@ -0,0 +1,120 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "mac-latency-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (MacLatencyTag)
+  ;
+
+TypeId
+MacLatencyTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MacLatencyTag")
+    .SetParent<Tag> ()
+    .AddConstructor<MacLatencyTag> ()
+  ;
+  return tid;
+}
+TypeId
+MacLatencyTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+MacLatencyTag::MacLatencyTag ()
+  : m_enqueue (Seconds (0)),
+    m_queueWait (Seconds (0)),
+    m_accessDelay (Seconds (0)),
+    m_airtime (Seconds (0)),
+    m_attempts (0)
+{
+}
+
+uint32_t
+MacLatencyTag::GetSerializedSize (void) const
+{
+  return sizeof (int64_t);
+}
+void
+MacLatencyTag::Serialize (TagBuffer i) const
+{
+  i.WriteU64 (m_enqueue.GetTimeStep ());
+}
+void
+MacLatencyTag::Deserialize (TagBuffer i)
+{
+  m_enqueue = TimeStep (i.ReadU64 ());
+}
+void
+MacLatencyTag::Print (std::ostream &os) const
+{
+  os << "Enqueue=" << m_enqueue
+     << " QueueWait=" << m_queueWait
+     << " AccessDelay=" << m_accessDelay
+     << " Attempts=" << m_attempts
+     << " Airtime=" << m_airtime;
+}
+
+void
+MacLatencyTag::SetEnqueueTime (Time enqueue)
+{
+  m_enqueue = enqueue;
+}
+Time
+MacLatencyTag::GetEnqueueTime (void) const
+{
+  return m_enqueue;
+}
+void
+MacLatencyTag::SetQueueWait (Time queueWait)
+{
+  m_queueWait = queueWait;
+}
+Time
+MacLatencyTag::GetQueueWait (void) const
+{
+  return m_queueWait;
+}
+void
+MacLatencyTag::AddAccessDelay (Time delay)
+{
+  m_accessDelay += delay;
+}
+Time
+MacLatencyTag::GetAccessDelay (void) const
+{
+  return m_accessDelay;
+}
+void
+MacLatencyTag::AddAttempt (Time airtime)
+{
+  m_attempts++;
+  m_airtime += airtime;
+}
+uint32_t
+MacLatencyTag::GetAttempts (void) const
+{
+  return m_attempts;
+}
+Time
+MacLatencyTag::GetAirtime (void) const
+{
+  return m_airtime;
+}
+
+} // namespace ns3
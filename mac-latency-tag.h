@@ -0,0 +1,101 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef MAC_LATENCY_TAG_H
+#define MAC_LATENCY_TAG_H
+
+#include "ns3/tag.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ *
+ * Breakdown of the time a frame spends in the MAC. DcaTxop stamps the
+ * enqueue time on every packet it queues, fills in its own copy of the
+ * tag while it serves the frame, and reports it once the frame is
+ * acknowledged or dropped. MacLow removes the tag from the frames it
+ * sends, so it never leaves the MAC. EdcaTxopN does not stamp its frames.
+ *
+ * Only the enqueue time is serialized into the packet, because packet
+ * tags are limited in size; the other fields exist only in the copy held
+ * by DcaTxop.
+ */
+class MacLatencyTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  MacLatencyTag ();
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * \param enqueue the time the frame entered the WifiMacQueue
+   */
+  void SetEnqueueTime (Time enqueue);
+  /**
+   * \return the time the frame entered the WifiMacQueue
+   */
+  Time GetEnqueueTime (void) const;
+  /**
+   * \param queueWait the time between enqueue and the moment the frame
+   *        reached the head of the queue
+   */
+  void SetQueueWait (Time queueWait);
+  /**
+   * \return the time between enqueue and the moment the frame reached
+   *         the head of the queue
+   */
+  Time GetQueueWait (void) const;
+  /**
+   * \param delay the time spent contending for one more transmission attempt
+   */
+  void AddAccessDelay (Time delay);
+  /**
+   * \return the total time spent contending for the medium, over all
+   *         transmission attempts
+   */
+  Time GetAccessDelay (void) const;
+  /**
+   * \param airtime the time taken on the medium by one more
+   *        transmission attempt, including the expected response
+   */
+  void AddAttempt (Time airtime);
+  /**
+   * \return the number of transmission attempts
+   */
+  uint32_t GetAttempts (void) const;
+  /**
+   * \return the total time taken on the medium by all attempts
+   */
+  Time GetAirtime (void) const;
+
+private:
+  Time m_enqueue;
+  Time m_queueWait;
+  Time m_accessDelay;
+  Time m_airtime;
+  uint32_t m_attempts;
+};
+
+} // namespace ns3
+
+#endif /* MAC_LATENCY_TAG_H */
@@ -34,6 +34,9 @@
 #include "qos-utils.h"
 #include "edca-txop-n.h"
 #include "snr-tag.h"
+#include "bss-color-tag.h"
+#include "mac-latency-tag.h"
+#include <cmath>
 
 NS_LOG_COMPONENT_DEFINE ("MacLow");
 
@@ -64,6 +67,10 @@ MacLowDcfListener::MacLowDcfListener ()
 MacLowDcfListener::~MacLowDcfListener ()
 {
 }
+void
+MacLowDcfListener::RxIgnored (void)
+{
+}
 
 MacLowBlockAckEventListener::MacLowBlockAckEventListener ()
 {
@@ -300,12 +307,20 @@ MacLow::MacLow ()
     m_currentPacket (0),
     m_listener (0),
     m_phyMacLowListener (0),
+    m_bssColor (0),
+    m_obssPdLevel (-82.0),
+    m_noiseFloor (-94.0),
+    m_rxIgnored (false),
+    m_ignoredRxUid (0),
+    m_srOpportunityEnd (Seconds (0)),
+    m_srTxop (false),
     m_ctsToSelfSupported (false)
 {
   NS_LOG_FUNCTION (this);
   m_lastNavDuration = Seconds (0);
   m_lastNavStart = Seconds (0);
   m_promisc = false;
+  ResetTxDurationCache ();
 }
 
 MacLow::~MacLow ()
@@ -337,6 +352,8 @@ MacLow::DoDispose (void)
   m_waitSifsEvent.Cancel ();
   m_endTxNoAckEvent.Cancel ();
    m_waitRifsEvent.Cancel();
+  m_cfPollResponseEvent.Cancel ();
+  m_cfPollCallback = MakeNullCallback<void> ();
   m_phy = 0;
   m_stationManager = 0;
   if (m_phyMacLowListener != 0)
@@ -424,7 +441,18 @@ MacLow::SetPhy (Ptr<WifiPhy> phy)
   m_phy = phy;
   m_phy->SetReceiveOkCallback (MakeCallback (&MacLow::ReceiveOk, this));
   m_phy->SetReceiveErrorCallback (MakeCallback (&MacLow::ReceiveError, this));
+  m_phy->TraceConnectWithoutContext ("PhyRxBegin", MakeCallback (&MacLow::RxBegin, this));
   SetupPhyMacLowListener (phy);
+  ResetTxDurationCache ();
+}
+void
+MacLow::ResetTxDurationCache (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < TX_DURATION_SLOTS; i++)
+    {
+      m_txDurations[i].valid = false;
+    }
 }
 void
 MacLow::SetWifiRemoteStationManager (Ptr<WifiRemoteStationManager> manager)
@@ -497,6 +525,39 @@ MacLow::SetPromisc (void)
 {
   m_promisc = true;
 }
+void
+MacLow::SetBssColor (uint8_t color)
+{
+  NS_LOG_FUNCTION (this << (uint32_t) color);
+  m_bssColor = color;
+}
+uint8_t
+MacLow::GetBssColor (void) const
+{
+  return m_bssColor;
+}
+void
+MacLow::SetObssPdLevel (double level)
+{
+  NS_LOG_FUNCTION (this << level);
+  m_obssPdLevel = level;
+}
+double
+MacLow::GetObssPdLevel (void) const
+{
+  return m_obssPdLevel;
+}
+void
+MacLow::SetNoiseFloor (double noiseFloor)
+{
+  NS_LOG_FUNCTION (this << noiseFloor);
+  m_noiseFloor = noiseFloor;
+}
+double
+MacLow::GetNoiseFloor (void) const
+{
+  return m_noiseFloor;
+}
 Mac48Address
 MacLow::GetAddress (void) const
 {
@@ -559,6 +620,17 @@ MacLow::SetRxCallback (Callback<void,Ptr<Packet>,const WifiMacHeader *> callback
   m_rxCallback = callback;
 }
 void
+MacLow::SetCfPollCallback (Callback<void> callback)
+{
+  m_cfPollCallback = callback;
+}
+void
+MacLow::RespondToCfPoll (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_cfPollCallback ();
+}
+void
 MacLow::RegisterDcfListener (MacLowDcfListener *listener)
 {
   m_dcfListeners.push_back (listener);
@@ -587,10 +659,16 @@ MacLow::StartTransmission (Ptr<const Packet> packet,
    * one of the Edca of the QAP.
    */
   m_currentPacket = packet->Copy ();
+  // the enqueue time stamped by DcaTxop stays in the MAC
+  MacLatencyTag latency;
+  m_currentPacket->RemovePacketTag (latency);
   m_currentHdr = *hdr;
   CancelAllEvents ();
   m_listener = listener;
   m_txParams = params;
+  // the whole frame exchange keeps the power limit of the spatial reuse
+  // opportunity it started in
+  m_srTxop = Simulator::Now () < m_srOpportunityEnd;
 
   //NS_ASSERT (m_phy->IsStateIdle ());
 
@@ -603,14 +681,14 @@ MacLow::StartTransmission (Ptr<const Packet> packet,
     }
   else
     {
-     if (NeedCtsToSelf() && m_ctsToSelfSupported)
+      if (m_ctsToSelfSupported && NeedCtsToSelf ())
         {
-          SendCtsToSelf();
+          SendCtsToSelf ();
         }
       else
         {
           SendDataPacket ();
-       }
+        }
     }
 
   /* When this method completes, we have taken ownership of the medium. */
@@ -627,6 +705,7 @@ MacLow::ReceiveError (Ptr<const Packet> packet, double rxSnr)
 {
   NS_LOG_FUNCTION (this << packet << rxSnr);
   NS_LOG_DEBUG ("rx failed ");
+  m_rxIgnored = false;
   if (m_txParams.MustWaitFastAck ())
     {
       NS_ASSERT (m_fastAckFailedTimeoutEvent.IsExpired ());
@@ -664,9 +743,29 @@ MacLow::ReceiveOk (Ptr<Packet> packet, double rxSnr, WifiMode txMode, WifiPreamb
   WifiMacHeader hdr;
   packet->RemoveHeader (hdr);
 
+  bool ignored = m_rxIgnored && packet->GetUid () == m_ignoredRxUid;
+  m_rxIgnored = false;
+  BssColorTag color;
+  bool colored = packet->RemovePacketTag (color);
+  if (m_bssColor != 0 && !hdr.IsCts () && !hdr.IsAck ())
+    {
+      // remember how strong each transmitter is, to judge its next
+      // frames as soon as their reception starts
+      double rxPower = 10.0 * std::log10 (rxSnr) + m_noiseFloor;
+      uint64_t key = MacAddressHashMap<double>::GetKey (hdr.GetAddr2 ());
+      *m_rxPowers.Insert (key, rxPower) = rxPower;
+    }
+  if (colored && hdr.IsBeacon () && hdr.GetAddr3 () == m_bssid)
+    {
+      m_bssColor = color.Get ();
+    }
+
   bool isPrevNavZero = IsNavZero ();
   NS_LOG_DEBUG ("duration/id=" << hdr.GetDuration ());
-  NotifyNav (packet,hdr, txMode, preamble);
+  if (!ignored)
+    {
+      NotifyNav (packet,hdr, txMode, preamble);
+    }
   if (hdr.IsRts ())
     {
       /* see section 9.2.5.7 802.11-1999
@@ -735,7 +834,9 @@ MacLow::ReceiveOk (Ptr<Packet> packet, double rxSnr, WifiMode txMode, WifiPreamb
       if (m_txParams.MustWaitNormalAck ()
           && m_normalAckTimeoutEvent.IsRunning ())
         {
-          m_normalAckTimeoutEvent.Cancel ();
+          // Remove rather than cancel the timeout: a cancelled event stays
+          // in the scheduler until it expires, once for every frame acked.
+          Simulator::Remove (m_normalAckTimeoutEvent);
           NotifyAckTimeoutResetNow ();
           gotAck = true;
         }
@@ -773,18 +874,19 @@ MacLow::ReceiveOk (Ptr<Packet> packet, double rxSnr, WifiMode txMode, WifiPreamb
       if (!blockAckReq.IsMultiTid ())
         {
           uint8_t tid = blockAckReq.GetTidInfo ();
-          AgreementsI it = m_bAckAgreements.find (std::make_pair (hdr.GetAddr2 (), tid));
-          if (it != m_bAckAgreements.end ())
+          uint64_t key = Agreements::GetKey (hdr.GetAddr2 (), tid);
+          AgreementValue *agreement = m_bAckAgreements.Find (key);
+          if (agreement != 0)
             {
               //Update block ack cache
-              BlockAckCachesI i = m_bAckCaches.find (std::make_pair (hdr.GetAddr2 (), tid));
-              NS_ASSERT (i != m_bAckCaches.end ());
-              (*i).second.UpdateWithBlockAckReq (blockAckReq.GetStartingSequence ());
+              BlockAckCache *cache = m_bAckCaches.Find (key);
+              NS_ASSERT (cache != 0);
+              cache->UpdateWithBlockAckReq (blockAckReq.GetStartingSequence ());
 
               NS_ASSERT (m_sendAckEvent.IsExpired ());
               /* See section 11.5.3 in IEEE802.11 for mean of this timer */
-              ResetBlockAckInactivityTimerIfNeeded (it->second.first);
-              if ((*it).second.first.IsImmediateBlockAck ())
+              ResetBlockAckInactivityTimerIfNeeded (agreement->first);
+              if (agreement->first.IsImmediateBlockAck ())
                 {
                   NS_LOG_DEBUG ("rx blockAckRequest/sendImmediateBlockAck from=" << hdr.GetAddr2 ());
                   m_sendAckEvent = Simulator::Schedule (GetSifs (),
@@ -813,6 +915,27 @@ MacLow::ReceiveOk (Ptr<Packet> packet, double rxSnr, WifiMode txMode, WifiPreamb
     {
       NS_LOG_DEBUG ("rx drop " << hdr.GetTypeString ());
     }
+  else if (hdr.GetType () == WIFI_MAC_DATA_NULL_CFPOLL)
+    {
+      /* A CF-Poll carries no data and is not acknowledged. The one
+       * addressed to us lets us transmit a SIFS later; the broadcast one
+       * ends the contention-free period and has already reset the NAV.
+       */
+      if (hdr.GetAddr1 () == m_self
+          && hdr.GetAddr2 () == m_bssid
+          && !m_cfPollCallback.IsNull ())
+        {
+          NS_LOG_DEBUG ("rx CF-Poll from=" << hdr.GetAddr2 ());
+          m_stationManager->ReportRxOk (hdr.GetAddr2 (), &hdr,
+                                        rxSnr, txMode);
+          m_cfPollResponseEvent = Simulator::Schedule (GetSifs (),
+                                                       &MacLow::RespondToCfPoll, this);
+        }
+      else
+        {
+          NS_LOG_DEBUG ("rx drop " << hdr.GetTypeString ());
+        }
+    }
   else if (hdr.GetAddr1 () == m_self)
     {
       m_stationManager->ReportRxOk (hdr.GetAddr2 (), &hdr,
@@ -827,8 +950,8 @@ MacLow::ReceiveOk (Ptr<Packet> packet, double rxSnr, WifiMode txMode, WifiPreamb
              QoS Control field of the QoS data frame. */
           if (hdr.IsQosAck ())
             {
-              AgreementsI it = m_bAckAgreements.find (std::make_pair (hdr.GetAddr2 (), hdr.GetQosTid ()));
-              RxCompleteBufferedPacketsWithSmallerSequence (it->second.first.GetStartingSequence (),
+              AgreementValue *agreement = m_bAckAgreements.Find (Agreements::GetKey (hdr.GetAddr2 (), hdr.GetQosTid ()));
+              RxCompleteBufferedPacketsWithSmallerSequence (agreement->first.GetStartingSequence (),
                                                             hdr.GetAddr2 (), hdr.GetQosTid ());
               RxCompleteBufferedPacketsUntilFirstLost (hdr.GetAddr2 (), hdr.GetQosTid ());
               NS_ASSERT (m_sendAckEvent.IsExpired ());
@@ -841,9 +964,9 @@ MacLow::ReceiveOk (Ptr<Packet> packet, double rxSnr, WifiMode txMode, WifiPreamb
             }
           else if (hdr.IsQosBlockAck ())
             {
-              AgreementsI it = m_bAckAgreements.find (std::make_pair (hdr.GetAddr2 (), hdr.GetQosTid ()));
+              AgreementValue *agreement = m_bAckAgreements.Find (Agreements::GetKey (hdr.GetAddr2 (), hdr.GetQosTid ()));
               /* See section 11.5.3 in IEEE802.11 for mean of this timer */
-              ResetBlockAckInactivityTimerIfNeeded (it->second.first);
+              ResetBlockAckInactivityTimerIfNeeded (agreement->first);
             }
           return;
         }
@@ -906,6 +1029,14 @@ MacLow::ReceiveOk (Ptr<Packet> packet, double rxSnr, WifiMode txMode, WifiPreamb
 rxPacket:
   WifiMacTrailer fcs;
   packet->RemoveTrailer (fcs);
+  if (hdr.IsBeacon () || hdr.IsProbeResp ())
+    {
+      // let the STAs compare the APs they hear
+      SnrTag tag;
+      packet->RemovePacketTag (tag);
+      tag.Set (rxSnr);
+      packet->AddPacketTag (tag);
+    }
   m_rxCallback (packet, &hdr);
   return;
 }
@@ -959,7 +1090,7 @@ MacLow::GetAckDuration (WifiTxVector ackTxVector) const
     preamble= WIFI_PREAMBLE_HT_MF;
   else
     preamble=WIFI_PREAMBLE_LONG;
-  return m_phy->CalculateTxDuration (GetAckSize (), ackTxVector, preamble);
+  return GetTxDuration (GetAckSize (), ackTxVector, preamble);
 }
 Time
 MacLow::GetBlockAckDuration (Mac48Address to, WifiTxVector blockAckReqTxVector, enum BlockAckType type) const
@@ -977,7 +1108,7 @@ MacLow::GetBlockAckDuration (Mac48Address to, WifiTxVector blockAckReqTxVector,
     preamble= WIFI_PREAMBLE_HT_MF;
   else
     preamble=WIFI_PREAMBLE_LONG;
-  return m_phy->CalculateTxDuration (GetBlockAckSize (type), blockAckReqTxVector, preamble);
+  return GetTxDuration (GetBlockAckSize (type), blockAckReqTxVector, preamble);
 }
 Time
 MacLow::GetCtsDuration (Mac48Address to, WifiTxVector rtsTxVector) const
@@ -994,7 +1125,28 @@ MacLow::GetCtsDuration (WifiTxVector ctsTxVector) const
     preamble= WIFI_PREAMBLE_HT_MF;
   else
     preamble=WIFI_PREAMBLE_LONG;
-  return m_phy->CalculateTxDuration (GetCtsSize (), ctsTxVector, preamble);
+  return GetTxDuration (GetCtsSize (), ctsTxVector, preamble);
+}
+Time
+MacLow::GetTxDuration (uint32_t size, WifiTxVector txVector, WifiPreamble preamble) const
+{
+  uint64_t key = size;
+  key = (key << 16) | (txVector.GetMode ().GetUid () & 0xffff);
+  key = (key << 4) | (preamble & 0xf);
+  key = (key << 3) | (txVector.GetNss () & 0x7);
+  key = (key << 3) | (txVector.GetNess () & 0x7);
+  key = (key << 1) | (txVector.IsStbc () ? 1 : 0);
+  key = (key << 1) | (txVector.IsShortGuardInterval () ? 1 : 0);
+
+  TxDurationEntry &entry = m_txDurations[(key ^ (key >> 11) ^ (key >> 27)) % TX_DURATION_SLOTS];
+  if (entry.valid && entry.key == key)
+    {
+      return entry.duration;
+    }
+  entry.key = key;
+  entry.duration = m_phy->CalculateTxDuration (size, txVector, preamble);
+  entry.valid = true;
+  return entry.duration;
 }
 uint32_t
 MacLow::GetCtsSize (void) const
@@ -1082,7 +1234,7 @@ MacLow::CalculateOverallTxTime (Ptr<const Packet> packet,
         {
           preamble = WIFI_PREAMBLE_LONG;
         }
-      txTime += m_phy->CalculateTxDuration (GetRtsSize (), rtsTxVector, preamble);
+      txTime += GetTxDuration (GetRtsSize (), rtsTxVector, preamble);
       txTime += GetCtsDuration (hdr->GetAddr1 (), rtsTxVector);
       txTime += Time (GetSifs () * 2);
     }
@@ -1095,7 +1247,7 @@ MacLow::CalculateOverallTxTime (Ptr<const Packet> packet,
   else
     preamble=WIFI_PREAMBLE_LONG;
   uint32_t dataSize = GetSize (packet, hdr);
-  txTime += m_phy->CalculateTxDuration (dataSize, dataTxVector, preamble);
+  txTime += GetTxDuration (dataSize, dataTxVector, preamble);
   if (params.MustWaitAck ())
     {
       txTime += GetSifs ();
@@ -1122,7 +1274,7 @@ MacLow::CalculateTransmissionTime (Ptr<const Packet> packet,
       else
         preamble=WIFI_PREAMBLE_LONG;
       txTime += GetSifs ();
-      txTime += m_phy->CalculateTxDuration (params.GetNextPacketSize (), dataTxVector, preamble);
+      txTime += GetTxDuration (params.GetNextPacketSize (), dataTxVector, preamble);
     }
   return txTime;
 }
@@ -1160,7 +1312,7 @@ MacLow::NotifyNav (Ptr<const Packet> packet,const WifiMacHeader &hdr, WifiMode t
           cts.SetType (WIFI_MAC_CTL_CTS);
           WifiTxVector txVector=GetRtsTxVector (packet, &hdr);
           Time navCounterResetCtsMissedDelay =
-            m_phy->CalculateTxDuration (cts.GetSerializedSize (), txVector, preamble) +
+            GetTxDuration (cts.GetSerializedSize (), txVector, preamble) +
             Time (2 * GetSifs ()) + Time (2 * GetSlotTime ());
           m_navCounterResetCtsMissed = Simulator::Schedule (navCounterResetCtsMissedDelay,
                                                             &MacLow::NavCounterResetCtsMissed, this,
@@ -1186,7 +1338,7 @@ MacLow::DoNavResetNow (Time duration)
       (*i)->NavReset (duration);
     }
   m_lastNavStart = Simulator::Now ();
-  m_lastNavStart = duration;
+  m_lastNavDuration = duration;
 }
 bool
 MacLow::DoNavStartNow (Time duration)
@@ -1249,9 +1401,104 @@ MacLow::ForwardDown (Ptr<const Packet> packet, const WifiMacHeader* hdr,
                 ", mode=" << txVector.GetMode() <<
                 ", duration=" << hdr->GetDuration () <<
                 ", seq=0x" << std::hex << m_currentHdr.GetSequenceControl () << std::dec);
+  if (m_bssColor != 0)
+    {
+      BssColorTag color;
+      if (!packet->PeekPacketTag (color))
+        {
+          packet->AddPacketTag (BssColorTag (m_bssColor));
+        }
+      txVector = RestrictTxPower (txVector);
+    }
   m_phy->SendPacket (packet, txVector.GetMode(), preamble, txVector);
 }
 
+void
+MacLow::RxBegin (Ptr<const Packet> packet)
+{
+  m_rxIgnored = false;
+  if (m_bssColor == 0)
+    {
+      return;
+    }
+  BssColorTag color;
+  if (!packet->PeekPacketTag (color)
+      || color.Get () == m_bssColor)
+    {
+      // our own BSS, or a BSS without color
+      return;
+    }
+  WifiMacHeader hdr;
+  packet->PeekHeader (hdr);
+  if (hdr.IsCts () || hdr.IsAck ()
+      || hdr.GetAddr1 () == m_self)
+    {
+      // the transmitter of a CTS or an ACK is unknown
+      return;
+    }
+  double *rxPower = m_rxPowers.Find (MacAddressHashMap<double>::GetKey (hdr.GetAddr2 ()));
+  if (rxPower == 0 || *rxPower >= m_obssPdLevel)
+    {
+      return;
+    }
+  if (m_phy->GetTxPowerStart () > GetSrTxPowerLimit ())
+    {
+      // even the lowest power level of the PHY is above the limit of
+      // the spatial reuse transmissions: defer as usual
+      return;
+    }
+  NS_LOG_DEBUG ("ignore rx from=" << hdr.GetAddr2 () << " color=" << (uint32_t) color.Get ()
+                << " power=" << *rxPower);
+  Simulator::ScheduleNow (&MacLow::IgnoreObssRx, this, packet->GetUid (), hdr.GetDuration ());
+}
+
+void
+MacLow::IgnoreObssRx (uint64_t uid, Time nav)
+{
+  NS_LOG_FUNCTION (this << uid << nav);
+  if (!m_phy->IsStateRx ())
+    {
+      return;
+    }
+  m_rxIgnored = true;
+  m_ignoredRxUid = uid;
+  m_srOpportunityEnd = Max (m_srOpportunityEnd,
+                            Simulator::Now () + m_phy->GetDelayUntilIdle () + nav);
+  for (DcfListenersCI i = m_dcfListeners.begin (); i != m_dcfListeners.end (); i++)
+    {
+      (*i)->RxIgnored ();
+    }
+}
+
+double
+MacLow::GetSrTxPowerLimit (void) const
+{
+  return 21.0 - (m_obssPdLevel + 82.0);
+}
+
+WifiTxVector
+MacLow::RestrictTxPower (WifiTxVector txVector) const
+{
+  if (!m_srTxop && Simulator::Now () >= m_srOpportunityEnd)
+    {
+      return txVector;
+    }
+  double maxPower = GetSrTxPowerLimit ();
+  double start = m_phy->GetTxPowerStart ();
+  double end = m_phy->GetTxPowerEnd ();
+  uint32_t nLevels = m_phy->GetNTxPower ();
+  uint8_t level = txVector.GetTxPowerLevel ();
+  // the PHY spreads its levels evenly from TxPowerStart to TxPowerEnd
+  while (level > 0
+         && nLevels > 1
+         && start + level * (end - start) / (nLevels - 1) > maxPower)
+    {
+      level--;
+    }
+  txVector.SetTxPowerLevel (level);
+  return txVector;
+}
+
 void
 MacLow::CtsTimeout (void)
 {
@@ -1361,14 +1608,14 @@ MacLow::SendRtsForPacket (void)
       duration += GetSifs ();
       duration += GetCtsDuration (m_currentHdr.GetAddr1 (), rtsTxVector);
       duration += GetSifs ();
-      duration += m_phy->CalculateTxDuration (GetSize (m_currentPacket, &m_currentHdr),
-                                              dataTxVector, preamble);
+      duration += GetTxDuration (GetSize (m_currentPacket, &m_currentHdr),
+                                 dataTxVector, preamble);
       duration += GetSifs ();
       duration += GetAckDuration (m_currentHdr.GetAddr1 (), dataTxVector);
     }
   rts.SetDuration (duration);
 
-  Time txDuration = m_phy->CalculateTxDuration (GetRtsSize (), rtsTxVector, preamble);
+  Time txDuration = GetTxDuration (GetRtsSize (), rtsTxVector, preamble);
   Time timerDelay = txDuration + GetCtsTimeout ();
 
   NS_ASSERT (m_ctsTimeoutEvent.IsExpired ());
@@ -1396,7 +1643,7 @@ MacLow::StartDataTxTimers (WifiTxVector dataTxVector)
   else
     preamble=WIFI_PREAMBLE_LONG;
  
-  Time txDuration = m_phy->CalculateTxDuration (GetSize (m_currentPacket, &m_currentHdr), dataTxVector, preamble);
+  Time txDuration = GetTxDuration (GetSize (m_currentPacket, &m_currentHdr), dataTxVector, preamble);
   if (m_txParams.MustWaitNormalAck ())
     {
       Time timerDelay = txDuration + GetAckTimeout ();
@@ -1497,8 +1744,8 @@ MacLow::SendDataPacket (void)
       if (m_txParams.HasNextPacket ())
         {
           duration += GetSifs ();
-          duration += m_phy->CalculateTxDuration (m_txParams.GetNextPacketSize (),
-                                                  dataTxVector, preamble);
+          duration += GetTxDuration (m_txParams.GetNextPacketSize (),
+                                     dataTxVector, preamble);
           if (m_txParams.MustWaitAck ())
             {
               duration += GetSifs ();
@@ -1557,8 +1804,8 @@ MacLow::SendCtsToSelf (void)
     {
       WifiTxVector dataTxVector = GetDataTxVector (m_currentPacket, &m_currentHdr);
       duration += GetSifs ();
-      duration += m_phy->CalculateTxDuration (GetSize (m_currentPacket,&m_currentHdr),
-                                              dataTxVector, preamble);
+      duration += GetTxDuration (GetSize (m_currentPacket,&m_currentHdr),
+                                 dataTxVector, preamble);
       if (m_txParams.MustWaitBasicBlockAck ())
         {
           
@@ -1578,8 +1825,8 @@ MacLow::SendCtsToSelf (void)
       if (m_txParams.HasNextPacket ())
         {
           duration += GetSifs ();
-          duration += m_phy->CalculateTxDuration (m_txParams.GetNextPacketSize (),
-                                                  dataTxVector, preamble);
+          duration += GetTxDuration (m_txParams.GetNextPacketSize (),
+                                     dataTxVector, preamble);
           if (m_txParams.MustWaitCompressedBlockAck ())
             {
               duration += GetSifs ();
@@ -1602,7 +1849,7 @@ MacLow::SendCtsToSelf (void)
 
   ForwardDown (packet, &cts, ctsTxVector,preamble);
 
-  Time txDuration = m_phy->CalculateTxDuration (GetCtsSize (), ctsTxVector, preamble);
+  Time txDuration = GetTxDuration (GetCtsSize (), ctsTxVector, preamble);
   txDuration += GetSifs ();
   NS_ASSERT (m_sendDataEvent.IsExpired ());
   
@@ -1672,8 +1919,8 @@ MacLow::SendDataAfterCts (Mac48Address source, Time duration, WifiMode txMode)
   Time newDuration = Seconds (0);
   newDuration += GetSifs ();
   newDuration += GetAckDuration (m_currentHdr.GetAddr1 (), dataTxVector);
-  Time txDuration = m_phy->CalculateTxDuration (GetSize (m_currentPacket, &m_currentHdr),
-                                                dataTxVector, preamble);
+  Time txDuration = GetTxDuration (GetSize (m_currentPacket, &m_currentHdr),
+                                   dataTxVector, preamble);
   duration -= txDuration;
   duration -= GetSifs ();
 
@@ -1754,28 +2001,29 @@ MacLow::SendAckAfterData (Mac48Address source, Time duration, WifiMode dataTxMod
 bool
 MacLow::StoreMpduIfNeeded (Ptr<Packet> packet, WifiMacHeader hdr)
 {
-  AgreementsI it = m_bAckAgreements.find (std::make_pair (hdr.GetAddr2 (), hdr.GetQosTid ()));
-  if (it != m_bAckAgreements.end ())
+  uint64_t key = Agreements::GetKey (hdr.GetAddr2 (), hdr.GetQosTid ());
+  AgreementValue *agreement = m_bAckAgreements.Find (key);
+  if (agreement != 0)
     {
       WifiMacTrailer fcs;
       packet->RemoveTrailer (fcs);
       BufferedPacket bufferedPacket (packet, hdr);
 
-      uint16_t endSequence = ((*it).second.first.GetStartingSequence () + 2047) % 4096;
+      uint16_t endSequence = (agreement->first.GetStartingSequence () + 2047) % 4096;
       uint16_t mappedSeqControl = QosUtilsMapSeqControlToUniqueInteger (hdr.GetSequenceControl (), endSequence);
 
-      BufferedPacketI i = (*it).second.second.begin ();
-      for (; i != (*it).second.second.end ()
+      BufferedPacketI i = agreement->second.begin ();
+      for (; i != agreement->second.end ()
            && QosUtilsMapSeqControlToUniqueInteger ((*i).second.GetSequenceControl (), endSequence) < mappedSeqControl; i++)
         {
           ;
         }
-      (*it).second.second.insert (i, bufferedPacket);
+      agreement->second.insert (i, bufferedPacket);
 
       //Update block ack cache
-      BlockAckCachesI j = m_bAckCaches.find (std::make_pair (hdr.GetAddr2 (), hdr.GetQosTid ()));
-      NS_ASSERT (j != m_bAckCaches.end ());
-      (*j).second.UpdateWithMpdu (&hdr);
+      BlockAckCache *cache = m_bAckCaches.Find (key);
+      NS_ASSERT (cache != 0);
+      cache->UpdateWithMpdu (&hdr);
 
       return true;
     }
@@ -1802,22 +2050,21 @@ MacLow::CreateBlockAckAgreement (const MgtAddBaResponseHeader *respHdr, Mac48Add
   agreement.SetStartingSequence (startingSeq);
 
   std::list<BufferedPacket> buffer (0);
-  AgreementKey key (originator, respHdr->GetTid ());
+  uint64_t key = Agreements::GetKey (originator, respHdr->GetTid ());
   AgreementValue value (agreement, buffer);
-  m_bAckAgreements.insert (std::make_pair (key, value));
+  AgreementValue *stored = m_bAckAgreements.Insert (key, value);
 
   BlockAckCache cache;
   cache.Init (startingSeq, respHdr->GetBufferSize () + 1);
-  m_bAckCaches.insert (std::make_pair (key, cache));
+  m_bAckCaches.Insert (key, cache);
 
   if (respHdr->GetTimeout () != 0)
     {
-      AgreementsI it = m_bAckAgreements.find (std::make_pair (originator, respHdr->GetTid ()));
       Time timeout = MicroSeconds (1024 * agreement.GetTimeout ());
 
       AcIndex ac = QosUtilsMapTidToAc (agreement.GetTid ());
 
-      it->second.first.m_inactivityEvent = Simulator::Schedule (timeout,
+      stored->first.m_inactivityEvent = Simulator::Schedule (timeout,
                                                                 &MacLowBlockAckEventListener::BlockAckInactivityTimeout,
                                                                 m_edcaListeners[ac],
                                                                 originator, tid);
@@ -1827,32 +2074,32 @@ MacLow::CreateBlockAckAgreement (const MgtAddBaResponseHeader *respHdr, Mac48Add
 void
 MacLow::DestroyBlockAckAgreement (Mac48Address originator, uint8_t tid)
 {
-  AgreementsI it = m_bAckAgreements.find (std::make_pair (originator, tid));
-  if (it != m_bAckAgreements.end ())
+  uint64_t key = Agreements::GetKey (originator, tid);
+  AgreementValue *agreement = m_bAckAgreements.Find (key);
+  if (agreement != 0)
     {
-      RxCompleteBufferedPacketsWithSmallerSequence (it->second.first.GetStartingSequence (), originator, tid);
+      RxCompleteBufferedPacketsWithSmallerSequence (agreement->first.GetStartingSequence (), originator, tid);
       RxCompleteBufferedPacketsUntilFirstLost (originator, tid);
-      m_bAckAgreements.erase (it);
+      m_bAckAgreements.Erase (key);
 
-      BlockAckCachesI i = m_bAckCaches.find (std::make_pair (originator, tid));
-      NS_ASSERT (i != m_bAckCaches.end ());
-      m_bAckCaches.erase (i);
+      NS_ASSERT (m_bAckCaches.Find (key) != 0);
+      m_bAckCaches.Erase (key);
     }
 }
 
 void
 MacLow::RxCompleteBufferedPacketsWithSmallerSequence (uint16_t seq, Mac48Address originator, uint8_t tid)
 {
-  AgreementsI it = m_bAckAgreements.find (std::make_pair (originator, tid));
-  if (it != m_bAckAgreements.end ())
+  AgreementValue *agreement = m_bAckAgreements.Find (Agreements::GetKey (originator, tid));
+  if (agreement != 0)
     {
-      uint16_t endSequence = ((*it).second.first.GetStartingSequence () + 2047) % 4096;
+      uint16_t endSequence = (agreement->first.GetStartingSequence () + 2047) % 4096;
       uint16_t mappedStart = QosUtilsMapSeqControlToUniqueInteger (seq, endSequence);
-      uint16_t guard = (*it).second.second.begin ()->second.GetSequenceControl () & 0xfff0;
-      BufferedPacketI last = (*it).second.second.begin ();
+      uint16_t guard = agreement->second.begin ()->second.GetSequenceControl () & 0xfff0;
+      BufferedPacketI last = agreement->second.begin ();
 
-      BufferedPacketI i = (*it).second.second.begin ();
-      for (; i != (*it).second.second.end ()
+      BufferedPacketI i = agreement->second.begin ();
+      for (; i != agreement->second.end ()
            && QosUtilsMapSeqControlToUniqueInteger ((*i).second.GetSequenceNumber (), endSequence) < mappedStart;)
         {
           if (guard == (*i).second.GetSequenceControl ())
@@ -1867,11 +2114,11 @@ MacLow::RxCompleteBufferedPacketsWithSmallerSequence (uint16_t seq, Mac48Address
                   m_rxCallback ((*last).first, &(*last).second);
                   last++;
                   /* go to next packet */
-                  while (i != (*it).second.second.end () && ((guard >> 4) & 0x0fff) == (*i).second.GetSequenceNumber ())
+                  while (i != agreement->second.end () && ((guard >> 4) & 0x0fff) == (*i).second.GetSequenceNumber ())
                     {
                       i++;
                     }
-                  if (i != (*it).second.second.end ())
+                  if (i != agreement->second.end ())
                     {
                       guard = (*i).second.GetSequenceControl () & 0xfff0;
                       last = i;
@@ -1885,33 +2132,33 @@ MacLow::RxCompleteBufferedPacketsWithSmallerSequence (uint16_t seq, Mac48Address
           else
             {
               /* go to next packet */
-              while (i != (*it).second.second.end () && ((guard >> 4) & 0x0fff) == (*i).second.GetSequenceNumber ())
+              while (i != agreement->second.end () && ((guard >> 4) & 0x0fff) == (*i).second.GetSequenceNumber ())
                 {
                   i++;
                 }
-              if (i != (*it).second.second.end ())
+              if (i != agreement->second.end ())
                 {
                   guard = (*i).second.GetSequenceControl () & 0xfff0;
                   last = i;
                 }
             }
         }
-      (*it).second.second.erase ((*it).second.second.begin (), i);
+      agreement->second.erase (agreement->second.begin (), i);
     }
 }
 
 void
 MacLow::RxCompleteBufferedPacketsUntilFirstLost (Mac48Address originator, uint8_t tid)
 {
-  AgreementsI it = m_bAckAgreements.find (std::make_pair (originator, tid));
-  if (it != m_bAckAgreements.end ())
+  AgreementValue *agreement = m_bAckAgreements.Find (Agreements::GetKey (originator, tid));
+  if (agreement != 0)
     {
-      uint16_t startingSeqCtrl = ((*it).second.first.GetStartingSequence () << 4) & 0xfff0;
+      uint16_t startingSeqCtrl = (agreement->first.GetStartingSequence () << 4) & 0xfff0;
       uint16_t guard = startingSeqCtrl;
 
-      BufferedPacketI lastComplete = (*it).second.second.begin ();
-      BufferedPacketI i = (*it).second.second.begin ();
-      for (; i != (*it).second.second.end () && guard == (*i).second.GetSequenceControl (); i++)
+      BufferedPacketI lastComplete = agreement->second.begin ();
+      BufferedPacketI i = agreement->second.begin ();
+      for (; i != agreement->second.end () && guard == (*i).second.GetSequenceControl (); i++)
         {
           if (!(*i).second.IsMoreFragments ())
             {
@@ -1925,10 +2172,10 @@ MacLow::RxCompleteBufferedPacketsUntilFirstLost (Mac48Address originator, uint8_
             }
           guard = (*i).second.IsMoreFragments () ? (guard + 1) : ((guard + 16) & 0xfff0);
         }
-      (*it).second.first.SetStartingSequence ((guard >> 4) & 0x0fff);
+      agreement->first.SetStartingSequence ((guard >> 4) & 0x0fff);
       /* All packets already forwarded to WifiMac must be removed from buffer:
       [begin (), lastComplete) */
-      (*it).second.second.erase ((*it).second.second.begin (), lastComplete);
+      agreement->second.erase (agreement->second.begin (), lastComplete);
     }
 }
 
@@ -2013,12 +2260,13 @@ MacLow::SendBlockAckAfterBlockAckRequest (const CtrlBAckRequestHeader reqHdr, Ma
   if (!reqHdr.IsMultiTid ())
     {
       tid = reqHdr.GetTidInfo ();
-      AgreementsI it = m_bAckAgreements.find (std::make_pair (originator, tid));
-      if (it != m_bAckAgreements.end ())
+      uint64_t key = Agreements::GetKey (originator, tid);
+      AgreementValue *agreement = m_bAckAgreements.Find (key);
+      if (agreement != 0)
         {
           blockAck.SetStartingSequence (reqHdr.GetStartingSequence ());
           blockAck.SetTidInfo (tid);
-          immediate = (*it).second.first.IsImmediateBlockAck ();
+          immediate = agreement->first.IsImmediateBlockAck ();
           if (reqHdr.IsBasic ())
             {
               blockAck.SetType (BASIC_BLOCK_ACK);
@@ -2027,9 +2275,9 @@ MacLow::SendBlockAckAfterBlockAckRequest (const CtrlBAckRequestHeader reqHdr, Ma
             {
               blockAck.SetType (COMPRESSED_BLOCK_ACK);
             }
-          BlockAckCachesI i = m_bAckCaches.find (std::make_pair (originator, tid));
-          NS_ASSERT (i != m_bAckCaches.end ());
-          (*i).second.FillBlockAckBitmap (&blockAck);
+          BlockAckCache *cache = m_bAckCaches.Find (key);
+          NS_ASSERT (cache != 0);
+          cache->FillBlockAckBitmap (&blockAck);
 
           /* All packets with smaller sequence than starting sequence control must be passed up to Wifimac
            * See 9.10.3 in IEEE8022.11e standard.
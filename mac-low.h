@@ -26,6 +26,7 @@
 #include <stdint.h>
 #include <ostream>
 #include <map>
+#include <list>
 
 #include "wifi-mac-header.h"
 #include "wifi-mode.h"
@@ -42,6 +43,7 @@
 #include "qos-utils.h"
 #include "block-ack-cache.h"
 #include "wifi-tx-vector.h"
+#include "mac-address-hash-map.h"
 
 namespace ns3 {
 
@@ -181,6 +183,12 @@ public:
    * Notify that CTS timeout has resetted.
    */
   virtual void CtsTimeoutReset () = 0;
+  /**
+   * Notify that the frame being received comes from an overlapping BSS
+   * and is weak enough to be ignored: the medium must be considered
+   * idle again, and the end of this reception will not be notified.
+   */
+  virtual void RxIgnored (void);
 };
 
 /**
@@ -425,6 +433,11 @@ public:
    * \param phy WifiPhy associated with this MacLow
    */
   void SetPhy (Ptr<WifiPhy> phy);
+  /**
+   * Forget all memoized frame durations. This must be called whenever
+   * the PHY is reconfigured for another standard.
+   */
+  void ResetTxDurationCache (void);
   /**
    * Set up WifiRemoteStationManager associated with this MacLow.
    *
@@ -502,6 +515,44 @@ public:
    * Enable promiscuous mode.
    */
   void SetPromisc (void);
+  /**
+   * \param color the color of our BSS, from 1 to 63, or 0 if the BSS has
+   *        no color
+   *
+   * Once the BSS has a color, every frame sent is tagged with it, and the
+   * frames from other BSSs received below the OBSS-PD level are ignored
+   * for CCA and NAV. A non-AP station which has no color takes the one
+   * of the beacons of its AP.
+   */
+  void SetBssColor (uint8_t color);
+  /**
+   * \return the color of our BSS, 0 if it has none
+   */
+  uint8_t GetBssColor (void) const;
+  /**
+   * \param level the OBSS-PD level, in dBm, from -82 to -62
+   *
+   * Frames from other BSSs received below this level are ignored. In
+   * exchange, the transmit power is limited to 21 - (level + 82) dBm
+   * for the transmissions started before the end of the ignored frame
+   * and of the medium reservation it carries.
+   */
+  void SetObssPdLevel (double level);
+  /**
+   * \return the OBSS-PD level, in dBm
+   */
+  double GetObssPdLevel (void) const;
+  /**
+   * \param noiseFloor the noise power of the PHY, in dBm
+   *
+   * The PHY reports SNRs only: this is used to turn them back into
+   * received powers, to be compared with the OBSS-PD level.
+   */
+  void SetNoiseFloor (double noiseFloor);
+  /**
+   * \return the noise power of the PHY, in dBm
+   */
+  double GetNoiseFloor (void) const;
   /**
    * Return whether CTS-to-self capability is supported.
    *
@@ -583,6 +634,14 @@ public:
    * an instance of ns3::MacRxMiddle.
    */
   void SetRxCallback (Callback<void,Ptr<Packet>,const WifiMacHeader *> callback);
+  /**
+   * \param callback the callback invoked a SIFS after a CF-Poll addressed
+   *        to this MacLow was received, to start the transmission the
+   *        AP grants us without contention.
+   *
+   * CF-Polls are ignored as long as no callback is set.
+   */
+  void SetCfPollCallback (Callback<void> callback);
   /**
    * \param listener listen to NAV events for every incoming
    *        and outgoing packet.
@@ -849,6 +908,18 @@ private:
    */
   Time GetAckDuration (Mac48Address to, WifiTxVector dataTxVector) const;
   Time GetBlockAckDuration (Mac48Address to, WifiTxVector blockAckReqTxVector, enum BlockAckType type) const;
+  /**
+   * Return the time required to transmit a frame of the given size with
+   * the given TXVECTOR and preamble. Results are memoized in a small LRU
+   * cache, since the same few (size, mode, preamble) tuples are used by
+   * every frame exchange.
+   *
+   * \param size the size of the frame (including FCS)
+   * \param txVector the TXVECTOR used to transmit the frame
+   * \param preamble the preamble used to transmit the frame
+   * \return the time required to transmit the frame
+   */
+  Time GetTxDuration (uint32_t size, WifiTxVector txVector, WifiPreamble preamble) const;
 
   /**
    * Check if CTS-to-self mechanism should be used for the current packet.
@@ -1066,10 +1137,44 @@ private:
    * \param phy the WifiPhy this MacLow is connected to
    */
   void SetupPhyMacLowListener (Ptr<WifiPhy> phy);
+  /**
+   * Invoke the CF-Poll callback, a SIFS after the CF-Poll was received.
+   */
+  void RespondToCfPoll (void);
+  /**
+   * \param packet the frame whose reception starts
+   *
+   * Decide whether the frame comes from another BSS and is weak enough
+   * to be ignored. It is only ignored if the PHY has a power level low
+   * enough for the transmissions that use the opportunity.
+   */
+  void RxBegin (Ptr<const Packet> packet);
+  /**
+   * \param uid the uid of the frame being received
+   * \param nav the duration of the medium reservation carried by the frame
+   *
+   * Ignore the frame being received: tell the DCF the medium is idle and
+   * open a spatial reuse opportunity until the end of its reservation.
+   * This runs once the PHY and the DCF have both seen the reception start.
+   */
+  void IgnoreObssRx (uint64_t uid, Time nav);
+  /**
+   * \param txVector the TXVECTOR of a frame about to be sent
+   * \return the TXVECTOR with the power level lowered to respect the
+   *         limit set by the OBSS-PD level, if we are using a spatial
+   *         reuse opportunity
+   */
+  WifiTxVector RestrictTxPower (WifiTxVector txVector) const;
+  /**
+   * \return the highest transmit power, in dBm, allowed during a spatial
+   *         reuse opportunity: 21 - (OBSS-PD level + 82)
+   */
+  double GetSrTxPowerLimit (void) const;
 
   Ptr<WifiPhy> m_phy; //!< Pointer to WifiPhy (actually send/receives frames)
   Ptr<WifiRemoteStationManager> m_stationManager; //!< Pointer to WifiRemoteStationManager (rate control)
   MacLowRxCallback m_rxCallback; //!< Callback to pass packet up
+  Callback<void> m_cfPollCallback; //!< Callback to answer a CF-Poll
   /**
    * typedef for an iterator for a list of MacLowDcfListener.
    */
@@ -1093,6 +1198,7 @@ private:
   EventId m_endTxNoAckEvent;            //!< Event for finishing transmission that does not require ACK
   EventId m_navCounterResetCtsMissed;   //!< Event to reset NAV when CTS is not received
   EventId m_waitRifsEvent;              //!< Wait for RIFS event
+  EventId m_cfPollResponseEvent;        //!< Event to answer a CF-Poll
 
   Ptr<Packet> m_currentPacket;              //!< Current packet transmitted/to be transmitted
   WifiMacHeader m_currentHdr;               //!< Header of the current packet
@@ -1114,6 +1220,15 @@ private:
 
   bool m_promisc;  //!< Flag if the device is operating in promiscuous mode
 
+  uint8_t m_bssColor;      //!< Color of our BSS, 0 if none
+  double m_obssPdLevel;    //!< OBSS-PD level, in dBm
+  double m_noiseFloor;     //!< Noise power of the PHY, in dBm
+  MacAddressHashMap<double> m_rxPowers; //!< Last received power of each transmitter, in dBm
+  bool m_rxIgnored;        //!< Whether the frame being received is ignored
+  uint64_t m_ignoredRxUid; //!< Uid of the frame ignored
+  Time m_srOpportunityEnd; //!< End of the reservation of the last frame ignored
+  bool m_srTxop;           //!< Whether the current transmission uses a spatial reuse opportunity
+
   class PhyMacLowListener * m_phyMacLowListener; //!< Listerner needed to monitor when a channel switching occurs.
 
   /*
@@ -1122,14 +1237,29 @@ private:
   typedef std::pair<Ptr<Packet>, WifiMacHeader> BufferedPacket;
   typedef std::list<BufferedPacket>::iterator BufferedPacketI;
 
-  typedef std::pair<Mac48Address, uint8_t> AgreementKey;
   typedef std::pair<BlockAckAgreement, std::list<BufferedPacket> > AgreementValue;
 
-  typedef std::map<AgreementKey, AgreementValue> Agreements;
-  typedef std::map<AgreementKey, AgreementValue>::iterator AgreementsI;
+  /*
+   * Both tables are keyed by Agreements::GetKey (originator, tid) and are
+   * looked up for every QoS data frame received.
+   */
+  typedef MacAddressHashMap<AgreementValue> Agreements;
+  typedef MacAddressHashMap<BlockAckCache> BlockAckCaches;
 
-  typedef std::map<AgreementKey, BlockAckCache> BlockAckCaches;
-  typedef std::map<AgreementKey, BlockAckCache>::iterator BlockAckCachesI;
+  /*
+   * Memoized results of WifiPhy::CalculateTxDuration, keyed by the packed
+   * (size, mode, preamble, TXVECTOR flags) tuple. The table is direct
+   * mapped: a key hashes to exactly one slot and a miss overwrites it, so
+   * lookups never allocate or reorder anything.
+   */
+  struct TxDurationEntry
+  {
+    uint64_t key;
+    Time duration;
+    bool valid;
+  };
+  static const uint32_t TX_DURATION_SLOTS = 64;
+  mutable TxDurationEntry m_txDurations[TX_DURATION_SLOTS];
 
   Agreements m_bAckAgreements;
   BlockAckCaches m_bAckCaches;
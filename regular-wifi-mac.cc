@@ -23,6 +23,7 @@
 #include "ns3/boolean.h"
 #include "ns3/pointer.h"
 #include "ns3/uinteger.h"
+#include "ns3/double.h"
 #include "ns3/trace-source-accessor.h"
 
 #include "mac-rx-middle.h"
@@ -54,20 +55,22 @@ RegularWifiMac::RegularWifiMac ()
 
   m_dcfManager = new DcfManager ();
   m_dcfManager->SetupLowListener (m_low);
+  m_dcfManager->SetMediumBusyCallback (MakeCallback (&RegularWifiMac::NotifyMediumBusy, this));
 
   m_dca = CreateObject<DcaTxop> ();
   m_dca->SetLow (m_low);
   m_dca->SetManager (m_dcfManager);
   m_dca->SetTxOkCallback (MakeCallback (&RegularWifiMac::TxOk, this));
   m_dca->SetTxFailedCallback (MakeCallback (&RegularWifiMac::TxFailed, this));
+  m_cfPollable = false;
+  m_typeOfStation = STA;
+  m_standardConfigured = false;
+  m_standardCwMin = 0;
+  m_standardCwMax = 0;
 
-  // Construct the EDCAFs. The ordering is important - highest
-  // priority (see Table 9-1 in IEEE 802.11-2007) must be created
-  // first.
-  SetupEdcaQueue (AC_VO);
-  SetupEdcaQueue (AC_VI);
-  SetupEdcaQueue (AC_BE);
-  SetupEdcaQueue (AC_BK);
+  // The EDCAFs, with their queues and Block Ack managers, are only
+  // constructed once QoS is enabled (see SetQosSupported): a non-QoS
+  // station never uses them.
 }
 
 RegularWifiMac::~RegularWifiMac ()
@@ -155,13 +158,36 @@ RegularWifiMac::SetupEdcaQueue (enum AcIndex ac)
   edca->SetTxFailedCallback (MakeCallback (&RegularWifiMac::TxFailed, this));
   edca->SetAccessCategory (ac);
   edca->CompleteConfig ();
+  edca->SetTypeOfStation (m_typeOfStation);
+  if (m_stationManager != 0)
+    {
+      edca->SetWifiRemoteStationManager (m_stationManager);
+    }
+  if (m_standardConfigured)
+    {
+      // QoS was enabled after the standard was configured: give the
+      // new EDCAF the parameters its peers already have.
+      ConfigureDcf (edca, m_standardCwMin, m_standardCwMax, ac);
+    }
   m_edca.insert (std::make_pair (ac, edca));
 }
 
+Ptr<EdcaTxopN>
+RegularWifiMac::GetEdcaQueue (enum AcIndex ac) const
+{
+  EdcaQueues::const_iterator i = m_edca.find (ac);
+  if (i == m_edca.end ())
+    {
+      return 0;
+    }
+  return i->second;
+}
+
 void
 RegularWifiMac::SetTypeOfStation (TypeOfStation type)
 {
   NS_LOG_FUNCTION (this << type);
+  m_typeOfStation = type;
   for (EdcaQueues::iterator i = m_edca.begin (); i != m_edca.end (); ++i)
     {
       i->second->SetTypeOfStation (type);
@@ -174,28 +200,34 @@ RegularWifiMac::GetDcaTxop () const
   return m_dca;
 }
 
+const DcfManager *
+RegularWifiMac::GetDcfManager (void) const
+{
+  return m_dcfManager;
+}
+
 Ptr<EdcaTxopN>
 RegularWifiMac::GetVOQueue () const
 {
-  return m_edca.find (AC_VO)->second;
+  return GetEdcaQueue (AC_VO);
 }
 
 Ptr<EdcaTxopN>
 RegularWifiMac::GetVIQueue () const
 {
-  return m_edca.find (AC_VI)->second;
+  return GetEdcaQueue (AC_VI);
 }
 
 Ptr<EdcaTxopN>
 RegularWifiMac::GetBEQueue () const
 {
-  return m_edca.find (AC_BE)->second;
+  return GetEdcaQueue (AC_BE);
 }
 
 Ptr<EdcaTxopN>
 RegularWifiMac::GetBKQueue () const
 {
-  return m_edca.find (AC_BK)->second;
+  return GetEdcaQueue (AC_BK);
 }
 
 void
@@ -239,6 +271,16 @@ RegularWifiMac::SetQosSupported (bool enable)
 {
   NS_LOG_FUNCTION (this);
   m_qosSupported = enable;
+  if (enable && m_edca.empty ())
+    {
+      // Construct the EDCAFs. The ordering is important - highest
+      // priority (see Table 9-1 in IEEE 802.11-2007) must be created
+      // first.
+      SetupEdcaQueue (AC_VO);
+      SetupEdcaQueue (AC_VI);
+      SetupEdcaQueue (AC_BE);
+      SetupEdcaQueue (AC_BK);
+    }
 }
 
 bool
@@ -271,6 +313,66 @@ RegularWifiMac::GetCtsToSelfSupported () const
    return  m_low->GetCtsToSelfSupported ();
 }
 
+void
+RegularWifiMac::SetCfPollable (bool enable)
+{
+  NS_LOG_FUNCTION (this << enable);
+  m_cfPollable = enable;
+  if (enable)
+    {
+      m_low->SetCfPollCallback (MakeCallback (&DcaTxop::NotifyPolled, m_dca));
+    }
+  else
+    {
+      m_low->SetCfPollCallback (MakeNullCallback<void> ());
+    }
+}
+
+bool
+RegularWifiMac::GetCfPollable (void) const
+{
+  return m_cfPollable;
+}
+
+void
+RegularWifiMac::SetBssColor (uint8_t color)
+{
+  NS_LOG_FUNCTION (this << (uint32_t) color);
+  m_low->SetBssColor (color);
+}
+
+uint8_t
+RegularWifiMac::GetBssColor (void) const
+{
+  return m_low->GetBssColor ();
+}
+
+void
+RegularWifiMac::SetObssPdLevel (double level)
+{
+  NS_LOG_FUNCTION (this << level);
+  m_low->SetObssPdLevel (level);
+}
+
+double
+RegularWifiMac::GetObssPdLevel (void) const
+{
+  return m_low->GetObssPdLevel ();
+}
+
+void
+RegularWifiMac::SetNoiseFloor (double noiseFloor)
+{
+  NS_LOG_FUNCTION (this << noiseFloor);
+  m_low->SetNoiseFloor (noiseFloor);
+}
+
+double
+RegularWifiMac::GetNoiseFloor (void) const
+{
+  return m_low->GetNoiseFloor ();
+}
+
 void
 RegularWifiMac::SetSlot (Time slotTime)
 {
@@ -659,6 +761,36 @@ RegularWifiMac::GetTypeId (void)
                    MakeBooleanAccessor (&RegularWifiMac::SetCtsToSelfSupported,
                                         &RegularWifiMac::GetCtsToSelfSupported),
                     MakeBooleanChecker ())
+    .AddAttribute ("CfPollable",
+                   "Whether this station asks the AP to be polled during its contention-free periods "
+                   "and answers its CF-Polls",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RegularWifiMac::SetCfPollable,
+                                        &RegularWifiMac::GetCfPollable),
+                   MakeBooleanChecker ())
+    .AddAttribute ("BssColor",
+                   "The color of the BSS, put on every frame sent so that the stations can tell the frames "
+                   "of overlapping BSSs apart; 0 disables spatial reuse. Non-AP stations take the color "
+                   "of their AP.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&RegularWifiMac::SetBssColor,
+                                         &RegularWifiMac::GetBssColor),
+                   MakeUintegerChecker<uint8_t> (0, 63))
+    .AddAttribute ("ObssPdLevel",
+                   "The received power (dBm) below which the frames of overlapping BSSs are ignored for "
+                   "CCA and NAV. The transmit power is then limited to 21 - (ObssPdLevel + 82) dBm "
+                   "until the end of the ignored frame's medium reservation.",
+                   DoubleValue (-82.0),
+                   MakeDoubleAccessor (&RegularWifiMac::SetObssPdLevel,
+                                       &RegularWifiMac::GetObssPdLevel),
+                   MakeDoubleChecker<double> (-82.0, -62.0))
+    .AddAttribute ("NoiseFloor",
+                   "The noise power (dBm) of the PHY, used to turn the SNRs it reports back into "
+                   "received powers",
+                   DoubleValue (-94.0),
+                   MakeDoubleAccessor (&RegularWifiMac::SetNoiseFloor,
+                                       &RegularWifiMac::GetNoiseFloor),
+                   MakeDoubleChecker<double> ())
     .AddAttribute ("DcaTxop", "The DcaTxop object",
                    PointerValue (),
                    MakePointerAccessor (&RegularWifiMac::GetDcaTxop),
@@ -689,6 +821,10 @@ RegularWifiMac::GetTypeId (void)
     .AddTraceSource ("TxErrHeader",
                      "The header of unsuccessfully transmitted packet",
                      MakeTraceSourceAccessor (&RegularWifiMac::m_txErrCallback))
+    .AddTraceSource ("MediumBusy",
+                     "The medium became busy, with the cause (DcfManager::BusyType) and expected duration "
+                     "(zero when the busy period of this cause ended early)",
+                     MakeTraceSourceAccessor (&RegularWifiMac::m_mediumBusyTrace))
   ;
 
   return tid;
@@ -725,6 +861,14 @@ RegularWifiMac::FinishConfigureStandard (enum WifiPhyStandard standard)
       NS_FATAL_ERROR ("Unsupported WifiPhyStandard in RegularWifiMac::FinishConfigureStandard ()");
     }
 
+  // The PHY has been (re)configured for this standard, so frame
+  // durations memoized by MacLow are no longer valid.
+  m_low->ResetTxDurationCache ();
+
+  m_standardConfigured = true;
+  m_standardCwMin = cwmin;
+  m_standardCwMax = cwmax;
+
   // The special value of AC_BE_NQOS which exists in the Access
   // Category enumeration allows us to configure plain old DCF.
   ConfigureDcf (m_dca, cwmin, cwmax, AC_BE_NQOS);
@@ -750,4 +894,10 @@ RegularWifiMac::TxFailed (const WifiMacHeader &hdr)
   m_txErrCallback (hdr);
 }
 
+void
+RegularWifiMac::NotifyMediumBusy (enum DcfManager::BusyType type, Time duration)
+{
+  m_mediumBusyTrace (type, duration);
+}
+
 } // namespace ns3
@@ -24,6 +24,7 @@
 
 #include "dca-txop.h"
 #include "edca-txop-n.h"
+#include "dcf-manager.h"
 #include "wifi-remote-station-manager.h"
 #include "ssid.h"
 #include "qos-utils.h"
@@ -36,7 +37,6 @@ class Dcf;
 class MacLow;
 class MacRxMiddle;
 class MacTxMiddle;
-class DcfManager;
 
 /**
  * \brief base class for all MAC-level wifi objects.
@@ -126,6 +126,45 @@ public:
    * \return true if CTS-to-self is supported, false otherwise.
    */
   bool GetCtsToSelfSupported () const;
+  /**
+   * Enable or disable answering the CF-Polls of the AP.
+   *
+   * \param enable true if this station answers CF-Polls, false otherwise
+   */
+  void SetCfPollable (bool enable);
+  /**
+   * Return whether this station answers the CF-Polls of the AP.
+   *
+   * \return true if this station answers CF-Polls, false otherwise
+   */
+  bool GetCfPollable (void) const;
+  /**
+   * \param color the color of our BSS, from 1 to 63, or 0 for none
+   */
+  void SetBssColor (uint8_t color);
+  /**
+   * \return the color of our BSS, which a non-AP station takes from the
+   *         beacons of its AP, 0 if it has none
+   */
+  uint8_t GetBssColor (void) const;
+  /**
+   * \param level the level, in dBm, below which the frames of other BSSs
+   *        are ignored for CCA and NAV
+   */
+  void SetObssPdLevel (double level);
+  /**
+   * \return the level, in dBm, below which the frames of other BSSs are
+   *         ignored for CCA and NAV
+   */
+  double GetObssPdLevel (void) const;
+  /**
+   * \param noiseFloor the noise power of the PHY, in dBm
+   */
+  void SetNoiseFloor (double noiseFloor);
+  /**
+   * \return the noise power of the PHY, in dBm
+   */
+  double GetNoiseFloor (void) const;
   /**
    * \return the MAC address associated to this MAC layer.
    */
@@ -230,6 +269,15 @@ public:
   virtual void SetCompressedBlockAckTimeout (Time blockAckTimeout);
   virtual Time GetCompressedBlockAckTimeout (void) const;
 
+  /**
+   * Accessor for the DCF manager, which holds the medium busy time
+   * statistics. The statistics of each channel access function are
+   * available through Dcf::GetDcfState.
+   *
+   * \return the DcfManager of this MAC
+   */
+  const DcfManager * GetDcfManager (void) const;
+
 protected:
   virtual void DoInitialize ();
   virtual void DoDispose ();
@@ -266,6 +314,12 @@ protected:
    */
   Ptr<DcaTxop> GetDcaTxop (void) const;
 
+  /**
+   * \param ac an Access Category
+   * \return the channel access function of the Access Category, 0 if
+   *         QoS is not supported
+   */
+  Ptr<EdcaTxopN> GetEdcaQueue (enum AcIndex ac) const;
   /**
    * Accessor for the AC_VO channel access function
    * 
@@ -314,6 +368,10 @@ protected:
    * \param type the type of station.
    */
   void SetTypeOfStation (TypeOfStation type);
+  TypeOfStation m_typeOfStation; //!< Type of station, given to the EDCAFs when they are created
+  bool m_standardConfigured; //!< whether FinishConfigureStandard has been called
+  uint32_t m_standardCwMin;  //!< CWmin of the configured standard, given to the EDCAFs created later
+  uint32_t m_standardCwMax;  //!< CWmax of the configured standard, given to the EDCAFs created later
 
   /**
    * This method acts as the MacRxMiddle receive callback and is
@@ -389,7 +447,10 @@ protected:
    */
   bool m_qosSupported;
   /**
-   * Enable or disable QoS support for the device.
+   * Enable or disable QoS support for the device. The EDCAFs are
+   * created the first time QoS is enabled. If the standard is already
+   * configured by then, they are given its contention parameters when
+   * they are created.
    *
    * \param enable whether QoS is supported
    */
@@ -439,9 +500,19 @@ private:
    * \param ac the Access Category index of the queue to initialise.
    */
   void SetupEdcaQueue (enum AcIndex ac);
+  /**
+   * Forward the start of a busy period to the MediumBusy trace source.
+   *
+   * \param type the cause of the busy period
+   * \param duration its expected duration
+   */
+  void NotifyMediumBusy (enum DcfManager::BusyType type, Time duration);
+
+  bool m_cfPollable; //!< whether this station answers CF-Polls
 
   TracedCallback<const WifiMacHeader &> m_txOkCallback;
   TracedCallback<const WifiMacHeader &> m_txErrCallback;
+  TracedCallback<enum DcfManager::BusyType, Time> m_mediumBusyTrace;
 };
 
 } // namespace ns3
@@ -27,6 +27,7 @@
 #include "ns3/pointer.h"
 #include "ns3/boolean.h"
 #include "ns3/trace-source-accessor.h"
+#include "ns3/double.h"
 
 #include "qos-tag.h"
 #include "mac-low.h"
@@ -37,7 +38,12 @@
 #include "msdu-aggregator.h"
 #include "amsdu-subframe-header.h"
 #include "mgt-headers.h"
+#include "vendor-mgt-headers.h"
 #include "ht-capabilities.h"
+#include "snr-tag.h"
+
+#include <algorithm>
+#include <cmath>
 
 NS_LOG_COMPONENT_DEFINE ("StaWifiMac");
 
@@ -87,6 +93,27 @@ StaWifiMac::GetTypeId (void)
                    BooleanValue (false),
                    MakeBooleanAccessor (&StaWifiMac::SetActiveProbing),
                    MakeBooleanChecker ())
+    .AddAttribute ("ScanDuration", "How long to collect the beacons and probe responses of the APs "
+                   "before associating with the least loaded one (0 to associate with the first AP heard).",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&StaWifiMac::m_scanDuration),
+                   MakeTimeChecker ())
+    .AddAttribute ("MinSnr", "The SNR (dB) below which an AP is only chosen if no AP is heard above it.",
+                   DoubleValue (10.0),
+                   MakeDoubleAccessor (&StaWifiMac::m_minSnr),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("AssocStaggerWindow", "The window over which the first association requests of the "
+                   "stations are spread after they hear their AP, so that large populations do not all "
+                   "send them at once (0 to send them right away).",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&StaWifiMac::m_assocStaggerWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("AssocStaggerSlots", "The number of slots of the AssocStaggerWindow. Each station "
+                   "takes the slot given by its address, so that stations with consecutive addresses "
+                   "never share a slot as long as there are no more of them than slots.",
+                   UintegerValue (512),
+                   MakeUintegerAccessor (&StaWifiMac::m_assocStaggerSlots),
+                   MakeUintegerChecker<uint32_t> (1))
     .AddTraceSource ("Assoc", "Associated with an access point.",
                      MakeTraceSourceAccessor (&StaWifiMac::m_assocLogger))
     .AddTraceSource ("DeAssoc", "Association with an access point lost.",
@@ -99,7 +126,10 @@ StaWifiMac::StaWifiMac ()
   : m_state (BEACON_MISSED),
     m_probeRequestEvent (),
     m_assocRequestEvent (),
-    m_beaconWatchdogEnd (Seconds (0.0))
+    m_beaconWatchdogEnd (Seconds (0.0)),
+    m_minSnr (10.0),
+    m_assocStaggerSlots (512),
+    m_associatedOnce (false)
 {
   NS_LOG_FUNCTION (this);
 
@@ -212,6 +242,11 @@ StaWifiMac::SendAssociationRequest (void)
       assoc.SetHtCapabilities (GetHtCapabilities());
       hdr.SetNoOrder();
     }
+  if (GetCfPollable ())
+    {
+      CfPollableHeader cfPollable;
+      packet->AddHeader (cfPollable);
+    }
 
   packet->AddHeader (assoc);
 
@@ -229,6 +264,26 @@ StaWifiMac::SendAssociationRequest (void)
                                              &StaWifiMac::AssocRequestTimeout, this);
 }
 
+void
+StaWifiMac::StartAssociation (void)
+{
+  NS_LOG_FUNCTION (this);
+  SetState (WAIT_ASSOC_RESP);
+  if (m_associatedOnce || !m_assocStaggerWindow.IsStrictlyPositive ())
+    {
+      SendAssociationRequest ();
+      return;
+    }
+  uint64_t slot = GetAddressValue () % m_assocStaggerSlots;
+  Time delay = MicroSeconds (m_assocStaggerWindow.GetMicroSeconds () * slot / m_assocStaggerSlots);
+  NS_LOG_DEBUG ("first assoc request in slot " << slot << ", after " << delay);
+  if (m_assocRequestEvent.IsRunning ())
+    {
+      m_assocRequestEvent.Cancel ();
+    }
+  m_assocRequestEvent = Simulator::Schedule (delay, &StaWifiMac::AssocRequestTimeout, this);
+}
+
 void
 StaWifiMac::TryToEnsureAssociated (void)
 {
@@ -318,6 +373,19 @@ StaWifiMac::RestartBeaconWatchdog (Time delay)
     }
 }
 
+uint64_t
+StaWifiMac::GetAddressValue (void) const
+{
+  uint8_t address[6];
+  GetAddress ().CopyTo (address);
+  uint64_t value = 0;
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      value = (value << 8) | address[i];
+    }
+  return value;
+}
+
 bool
 StaWifiMac::IsAssociated (void) const
 {
@@ -487,16 +555,68 @@ StaWifiMac::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
         {
           goodBeacon = false;
         }
+      bool scanning = goodBeacon && IsScanning ();
+      bool uplinkWindow = false;
+      BssLoadHeader load;
+      bool loadKnown = false;
+      uint8_t subtype;
+      uint32_t size;
+      while (VendorSpecificElement::Peek (packet, &subtype, &size))
+        {
+          if (subtype == VendorSpecificElement::BSS_LOAD)
+            {
+              packet->RemoveHeader (load);
+              loadKnown = true;
+            }
+          else if (subtype == VendorSpecificElement::UPLINK_WINDOW)
+            {
+              UplinkWindowHeader window;
+              packet->RemoveHeader (window);
+              // an empty window, whatever the AP announces, is ignored
+              if (goodBeacon && !scanning && window.GetGroups () > 1
+                  && window.GetWindowDuration ().IsStrictlyPositive ())
+                {
+                  // the window of our group comes after those of the
+                  // groups with a lower index
+                  uint32_t group = GetAddressValue () % window.GetGroups ();
+                  int64_t us = window.GetWindowDuration ().GetMicroSeconds ();
+                  m_dca->SetAccessWindow (Simulator::Now () + MicroSeconds (us * group),
+                                          MicroSeconds (us),
+                                          MicroSeconds (us * window.GetGroups ()));
+                  uplinkWindow = true;
+                }
+            }
+          else
+            {
+              packet->RemoveAtStart (size);
+            }
+        }
+      if (scanning)
+        {
+          ApCandidate candidate;
+          candidate.bssid = hdr->GetAddr3 ();
+          SnrTag snr;
+          candidate.snr = packet->PeekPacketTag (snr) ? snr.Get () : 0.0;
+          candidate.loadKnown = loadKnown;
+          candidate.stations = load.GetStationCount ();
+          candidate.utilization = load.GetChannelUtilization ();
+          candidate.beaconIntervalUs = beacon.GetBeaconIntervalUs ();
+          AddCandidate (candidate);
+          return;
+        }
       if (goodBeacon)
         {
           Time delay = MicroSeconds (beacon.GetBeaconIntervalUs () * m_maxMissedBeacons);
           RestartBeaconWatchdog (delay);
           SetBssid (hdr->GetAddr3 ());
+          if (!uplinkWindow)
+            {
+              m_dca->ClearAccessWindow ();
+            }
         }
       if (goodBeacon && m_state == BEACON_MISSED)
         {
-          SetState (WAIT_ASSOC_RESP);
-          SendAssociationRequest ();
+          StartAssociation ();
         }
       return;
     }
@@ -520,6 +640,36 @@ StaWifiMac::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
                  return;
                }
             }
+          if (IsScanning ())
+            {
+              ApCandidate candidate;
+              candidate.bssid = hdr->GetAddr3 ();
+              SnrTag snr;
+              candidate.snr = packet->PeekPacketTag (snr) ? snr.Get () : 0.0;
+              candidate.loadKnown = false;
+              candidate.stations = 0;
+              candidate.utilization = 0;
+              candidate.beaconIntervalUs = probeResp.GetBeaconIntervalUs ();
+              uint8_t subtype;
+              uint32_t size;
+              while (VendorSpecificElement::Peek (packet, &subtype, &size))
+                {
+                  if (subtype == VendorSpecificElement::BSS_LOAD)
+                    {
+                      BssLoadHeader load;
+                      packet->RemoveHeader (load);
+                      candidate.loadKnown = true;
+                      candidate.stations = load.GetStationCount ();
+                      candidate.utilization = load.GetChannelUtilization ();
+                    }
+                  else
+                    {
+                      packet->RemoveAtStart (size);
+                    }
+                }
+              AddCandidate (candidate);
+              return;
+            }
           SetBssid (hdr->GetAddr3 ());
           Time delay = MicroSeconds (probeResp.GetBeaconIntervalUs () * m_maxMissedBeacons);
           RestartBeaconWatchdog (delay);
@@ -527,8 +677,7 @@ StaWifiMac::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
             {
               m_probeRequestEvent.Cancel ();
             }
-          SetState (WAIT_ASSOC_RESP);
-          SendAssociationRequest ();
+          StartAssociation ();
         }
       return;
     }
@@ -546,6 +695,31 @@ StaWifiMac::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
             {
               SetState (ASSOCIATED);
               NS_LOG_DEBUG ("assoc completed");
+              m_refusedBy.clear ();
+              bool backoffSlot = false;
+              uint8_t subtype;
+              uint32_t size;
+              while (VendorSpecificElement::Peek (packet, &subtype, &size))
+                {
+                  if (subtype == VendorSpecificElement::BACKOFF_SLOT)
+                    {
+                      BackoffSlotHeader slot;
+                      packet->RemoveHeader (slot);
+                      if (slot.GetSlot () < slot.GetCycleLength ())
+                        {
+                          m_dca->SetBackoffSlot (slot.GetSlot (), slot.GetCycleLength ());
+                          backoffSlot = true;
+                        }
+                    }
+                  else
+                    {
+                      packet->RemoveAtStart (size);
+                    }
+                }
+              if (!backoffSlot)
+                {
+                  m_dca->ClearBackoffSlot ();
+                }
               SupportedRates rates = assocResp.GetSupportedRates ();
               if (m_htSupported)
                 {
@@ -586,8 +760,41 @@ StaWifiMac::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
             }
           else
             {
-              NS_LOG_DEBUG ("assoc refused");
-              SetState (REFUSED);
+              m_refusedBy.push_back (GetBssid ());
+              Mac48Address target;
+              bool redirected = false;
+              uint8_t subtype;
+              uint32_t size;
+              while (VendorSpecificElement::Peek (packet, &subtype, &size))
+                {
+                  if (subtype == VendorSpecificElement::BSS_REDIRECT)
+                    {
+                      BssRedirectHeader redirection;
+                      packet->RemoveHeader (redirection);
+                      target = redirection.GetTarget ();
+                      redirected = std::find (m_refusedBy.begin (), m_refusedBy.end (), target) == m_refusedBy.end ();
+                    }
+                  else
+                    {
+                      packet->RemoveAtStart (size);
+                    }
+                }
+              if (redirected)
+                {
+                  NS_LOG_DEBUG ("assoc refused, redirected to " << target);
+                  SetBssid (target);
+                  SetState (WAIT_ASSOC_RESP);
+                  SendAssociationRequest ();
+                }
+              else if (m_scanDuration.IsStrictlyPositive () && SelectCandidate ())
+                {
+                  NS_LOG_DEBUG ("assoc refused, trying the next AP");
+                }
+              else
+                {
+                  NS_LOG_DEBUG ("assoc refused");
+                  SetState (REFUSED);
+                }
             }
         }
       return;
@@ -599,6 +806,101 @@ StaWifiMac::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
   RegularWifiMac::Receive (packet, hdr);
 }
 
+bool
+StaWifiMac::IsScanning (void) const
+{
+  return m_scanDuration.IsStrictlyPositive ()
+         && (m_state == BEACON_MISSED || m_state == WAIT_PROBE_RESP);
+}
+
+void
+StaWifiMac::AddCandidate (const ApCandidate &candidate)
+{
+  NS_LOG_FUNCTION (this << candidate.bssid << candidate.snr);
+  if (!m_scanEvent.IsRunning ())
+    {
+      // a new scan
+      m_candidates.clear ();
+      m_refusedBy.clear ();
+      m_scanEvent = Simulator::Schedule (m_scanDuration, &StaWifiMac::EndScan, this);
+    }
+  for (std::list<ApCandidate>::iterator i = m_candidates.begin (); i != m_candidates.end (); i++)
+    {
+      if (i->bssid == candidate.bssid)
+        {
+          *i = candidate;
+          return;
+        }
+    }
+  m_candidates.push_back (candidate);
+}
+
+void
+StaWifiMac::EndScan (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (IsScanning () && !SelectCandidate ())
+    {
+      SetState (REFUSED);
+    }
+}
+
+bool
+StaWifiMac::SelectCandidate (void)
+{
+  NS_LOG_FUNCTION (this);
+  double minSnr = std::pow (10.0, m_minSnr / 10.0);
+  std::list<ApCandidate>::const_iterator best = m_candidates.end ();
+  for (std::list<ApCandidate>::const_iterator i = m_candidates.begin (); i != m_candidates.end (); i++)
+    {
+      if (std::find (m_refusedBy.begin (), m_refusedBy.end (), i->bssid) == m_refusedBy.end ()
+          && (best == m_candidates.end () || IsBetterCandidate (*i, *best, minSnr)))
+        {
+          best = i;
+        }
+    }
+  if (best == m_candidates.end ())
+    {
+      return false;
+    }
+  NS_LOG_DEBUG ("chose bssid=" << best->bssid << " out of " << m_candidates.size () << " APs");
+  SetBssid (best->bssid);
+  RestartBeaconWatchdog (MicroSeconds (best->beaconIntervalUs * m_maxMissedBeacons));
+  if (m_probeRequestEvent.IsRunning ())
+    {
+      m_probeRequestEvent.Cancel ();
+    }
+  StartAssociation ();
+  return true;
+}
+
+bool
+StaWifiMac::IsBetterCandidate (const ApCandidate &a, const ApCandidate &b, double minSnr)
+{
+  bool aHeard = a.snr >= minSnr;
+  bool bHeard = b.snr >= minSnr;
+  if (aHeard != bHeard)
+    {
+      return aHeard;
+    }
+  if (aHeard)
+    {
+      if (a.loadKnown != b.loadKnown)
+        {
+          return a.loadKnown;
+        }
+      if (a.loadKnown && a.stations != b.stations)
+        {
+          return a.stations < b.stations;
+        }
+      if (a.loadKnown && a.utilization != b.utilization)
+        {
+          return a.utilization < b.utilization;
+        }
+    }
+  return a.snr > b.snr;
+}
+
 SupportedRates
 StaWifiMac::GetSupportedRates (void) const
 {
@@ -638,6 +940,7 @@ StaWifiMac::SetState (MacState value)
       && m_state != ASSOCIATED)
     {
       m_assocLogger (GetBssid ());
+      m_associatedOnce = true;
     }
   else if (value != ASSOCIATED
            && m_state == ASSOCIATED)
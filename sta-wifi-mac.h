@@ -0,0 +1,192 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2006, 2009 INRIA
+ * Copyright (c) 2009 MIRKO BANCHI
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
+ * Author: Mirko Banchi <mk.banchi@gmail.com>
+ */
+#ifndef STA_WIFI_MAC_H
+#define STA_WIFI_MAC_H
+
+#include "regular-wifi-mac.h"
+
+#include "ns3/event-id.h"
+#include "ns3/packet.h"
+#include "ns3/traced-callback.h"
+
+#include "supported-rates.h"
+#include "amsdu-subframe-header.h"
+#include "ht-capabilities.h"
+
+#include <list>
+
+namespace ns3  {
+
+class MgtAddBaRequestHeader;
+
+/**
+ * \ingroup wifi
+ *
+ * The Wifi MAC high model for a non-AP STA in a BSS.
+ */
+class StaWifiMac : public RegularWifiMac
+{
+public:
+  static TypeId GetTypeId (void);
+
+  StaWifiMac ();
+  virtual ~StaWifiMac ();
+
+  /**
+   * \param packet the packet to send.
+   * \param to the address to which the packet should be sent.
+   *
+   * The packet should be enqueued in a tx queue, and should be
+   * dequeued as soon as the channel access function determines that
+   * access is granted to this MAC.
+   */
+  virtual void Enqueue (Ptr<const Packet> packet, Mac48Address to);
+
+  /**
+   * \param missed the number of beacons which must be missed
+   * before a new association sequence is started.
+   */
+  void SetMaxMissedBeacons (uint32_t missed);
+  /**
+   * \param timeout
+   *
+   * If no probe response is received within the specified
+   * timeout, the station sends a new probe request.
+   */
+  void SetProbeRequestTimeout (Time timeout);
+  /**
+   * \param timeout
+   *
+   * If no association response is received within the specified
+   * timeout, the station sends a new association request.
+   */
+  void SetAssocRequestTimeout (Time timeout);
+
+  /**
+   * Start an active association sequence immediately.
+   */
+  void StartActiveAssociation (void);
+
+private:
+  enum MacState
+  {
+    ASSOCIATED,
+    WAIT_PROBE_RESP,
+    WAIT_ASSOC_RESP,
+    BEACON_MISSED,
+    REFUSED
+  };
+
+  /**
+   * An AP heard while scanning.
+   */
+  struct ApCandidate
+  {
+    Mac48Address bssid;
+    double snr;                //!< SNR of its last beacon or probe response
+    bool loadKnown;            //!< whether it advertises its load
+    uint16_t stations;         //!< its number of associated stations
+    uint8_t utilization;       //!< its channel utilization, out of 255
+    uint64_t beaconIntervalUs; //!< its beacon interval
+  };
+
+  void SetActiveProbing (bool enable);
+  virtual void Receive (Ptr<Packet> packet, const WifiMacHeader *hdr);
+  void SendProbeRequest (void);
+  void SendAssociationRequest (void);
+  /**
+   * Enter WAIT_ASSOC_RESP and send an association request to the
+   * current BSSID, right away or, for the first association, in the
+   * slot of the AssocStaggerWindow given by our address.
+   */
+  void StartAssociation (void);
+  void TryToEnsureAssociated (void);
+  void AssocRequestTimeout (void);
+  void ProbeRequestTimeout (void);
+  bool IsAssociated (void) const;
+  bool IsWaitAssocResp (void) const;
+  void MissedBeacons (void);
+  void RestartBeaconWatchdog (Time delay);
+  SupportedRates GetSupportedRates (void) const;
+  void SetState (enum MacState value);
+  HtCapabilities GetHtCapabilities (void) const;
+  /**
+   * \return our address as an integer, to spread the stations over slots
+   */
+  uint64_t GetAddressValue (void) const;
+  /**
+   * \return true if the beacons and probe responses received now are
+   *         collected for ScanDuration before choosing an AP, instead
+   *         of associating with the first AP heard
+   */
+  bool IsScanning (void) const;
+  /**
+   * Record or update an AP heard while scanning, and start the scan
+   * if it is the first one.
+   *
+   * \param candidate the AP
+   */
+  void AddCandidate (const ApCandidate &candidate);
+  /**
+   * The scan is over: associate with the best AP heard.
+   */
+  void EndScan (void);
+  /**
+   * Start associating with the best AP heard during the last scan
+   * which did not refuse us.
+   *
+   * \return false if there is no such AP
+   */
+  bool SelectCandidate (void);
+  /**
+   * \param a an AP
+   * \param b another AP
+   * \param minSnr the lowest SNR at which an AP is considered
+   * \return true if a is better than b: above the SNR threshold if b is
+   *         not, less loaded if both are, stronger otherwise
+   */
+  static bool IsBetterCandidate (const ApCandidate &a, const ApCandidate &b, double minSnr);
+
+  enum MacState m_state;
+  Time m_probeRequestTimeout;
+  Time m_assocRequestTimeout;
+  EventId m_probeRequestEvent;
+  EventId m_assocRequestEvent;
+  EventId m_beaconWatchdog;
+  Time m_beaconWatchdogEnd;
+  uint32_t m_maxMissedBeacons;
+  Time m_scanDuration;
+  double m_minSnr; //!< in dB
+  EventId m_scanEvent;
+  std::list<ApCandidate> m_candidates; //!< APs heard during the last scan
+  std::list<Mac48Address> m_refusedBy; //!< APs which refused us since the last scan
+  Time m_assocStaggerWindow;
+  uint32_t m_assocStaggerSlots;
+  bool m_associatedOnce; //!< whether we have ever been associated
+
+  TracedCallback<Mac48Address> m_assocLogger;
+  TracedCallback<Mac48Address> m_deAssocLogger;
+};
+
+} // namespace ns3
+
+#endif /* STA_WIFI_MAC_H */
@@ -0,0 +1,417 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "vendor-mgt-headers.h"
+#include "ns3/assert.h"
+#include "ns3/address-utils.h"
+
+namespace ns3 {
+
+static const uint8_t VENDOR_SPECIFIC_ELEMENT_ID = 221;
+// a locally administered OUI: these elements are only understood by our own MACs
+static const uint8_t VENDOR_OUI[3] = { 0x02, 0x00, 0x5a };
+// element ID, length, OUI and subtype
+static const uint32_t VENDOR_PREFIX_SIZE = 6;
+
+/***********************************************************
+ *          Vendor specific element
+ ***********************************************************/
+
+bool
+VendorSpecificElement::Peek (Ptr<const Packet> packet, uint8_t *subtype, uint32_t *size)
+{
+  uint8_t prefix[VENDOR_PREFIX_SIZE];
+  if (packet->CopyData (prefix, VENDOR_PREFIX_SIZE) < VENDOR_PREFIX_SIZE
+      || prefix[0] != VENDOR_SPECIFIC_ELEMENT_ID
+      || prefix[2] != VENDOR_OUI[0]
+      || prefix[3] != VENDOR_OUI[1]
+      || prefix[4] != VENDOR_OUI[2])
+    {
+      return false;
+    }
+  *subtype = prefix[5];
+  *size = 2 + prefix[1];
+  return *size <= packet->GetSize ();
+}
+
+uint32_t
+VendorSpecificElement::GetSerializedSize (void) const
+{
+  return VENDOR_PREFIX_SIZE + GetBodySize ();
+}
+void
+VendorSpecificElement::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.WriteU8 (VENDOR_SPECIFIC_ELEMENT_ID);
+  i.WriteU8 (VENDOR_PREFIX_SIZE - 2 + GetBodySize ());
+  i.Write (VENDOR_OUI, 3);
+  i.WriteU8 (GetSubtype ());
+  SerializeBody (i);
+}
+uint32_t
+VendorSpecificElement::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  uint8_t id = i.ReadU8 ();
+  uint8_t length = i.ReadU8 ();
+  i.Next (3);
+  uint8_t subtype = i.ReadU8 ();
+  NS_ASSERT (id == VENDOR_SPECIFIC_ELEMENT_ID && subtype == GetSubtype ());
+  NS_ASSERT (length == VENDOR_PREFIX_SIZE - 2 + GetBodySize ());
+  DeserializeBody (i);
+  return i.GetDistanceFrom (start);
+}
+
+/***********************************************************
+ *          Uplink access windows
+ ***********************************************************/
+
+NS_OBJECT_ENSURE_REGISTERED (UplinkWindowHeader)
+  ;
+
+UplinkWindowHeader::UplinkWindowHeader ()
+  : m_groups (1),
+    m_windowUs (0)
+{
+}
+
+void
+UplinkWindowHeader::SetGroups (uint8_t groups)
+{
+  m_groups = groups;
+}
+void
+UplinkWindowHeader::SetWindowDuration (Time duration)
+{
+  m_windowUs = duration.GetMicroSeconds ();
+}
+uint8_t
+UplinkWindowHeader::GetGroups (void) const
+{
+  return m_groups;
+}
+Time
+UplinkWindowHeader::GetWindowDuration (void) const
+{
+  return MicroSeconds (m_windowUs);
+}
+
+TypeId
+UplinkWindowHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::UplinkWindowHeader")
+    .SetParent<Header> ()
+    .AddConstructor<UplinkWindowHeader> ()
+  ;
+  return tid;
+}
+TypeId
+UplinkWindowHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+void
+UplinkWindowHeader::Print (std::ostream &os) const
+{
+  os << "groups=" << (uint32_t) m_groups
+     << ", window=" << m_windowUs << "us";
+}
+
+uint8_t
+UplinkWindowHeader::GetSubtype (void) const
+{
+  return UPLINK_WINDOW;
+}
+uint32_t
+UplinkWindowHeader::GetBodySize (void) const
+{
+  return 1 + 4;
+}
+void
+UplinkWindowHeader::SerializeBody (Buffer::Iterator &i) const
+{
+  i.WriteU8 (m_groups);
+  i.WriteHtolsbU32 (m_windowUs);
+}
+void
+UplinkWindowHeader::DeserializeBody (Buffer::Iterator &i)
+{
+  m_groups = i.ReadU8 ();
+  m_windowUs = i.ReadLsbtohU32 ();
+}
+
+/***********************************************************
+ *          CF-Pollable stations
+ ***********************************************************/
+
+NS_OBJECT_ENSURE_REGISTERED (CfPollableHeader)
+  ;
+
+TypeId
+CfPollableHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CfPollableHeader")
+    .SetParent<Header> ()
+    .AddConstructor<CfPollableHeader> ()
+  ;
+  return tid;
+}
+TypeId
+CfPollableHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+void
+CfPollableHeader::Print (std::ostream &os) const
+{
+  os << "cf-pollable";
+}
+
+uint8_t
+CfPollableHeader::GetSubtype (void) const
+{
+  return CF_POLLABLE;
+}
+uint32_t
+CfPollableHeader::GetBodySize (void) const
+{
+  return 0;
+}
+void
+CfPollableHeader::SerializeBody (Buffer::Iterator &i) const
+{
+}
+void
+CfPollableHeader::DeserializeBody (Buffer::Iterator &i)
+{
+}
+
+/***********************************************************
+ *          Backoff slot assignment
+ ***********************************************************/
+
+NS_OBJECT_ENSURE_REGISTERED (BackoffSlotHeader)
+  ;
+
+BackoffSlotHeader::BackoffSlotHeader ()
+  : m_slot (0),
+    m_cycleLength (1)
+{
+}
+
+void
+BackoffSlotHeader::SetSlot (uint16_t slot)
+{
+  m_slot = slot;
+}
+void
+BackoffSlotHeader::SetCycleLength (uint16_t length)
+{
+  m_cycleLength = length;
+}
+uint16_t
+BackoffSlotHeader::GetSlot (void) const
+{
+  return m_slot;
+}
+uint16_t
+BackoffSlotHeader::GetCycleLength (void) const
+{
+  return m_cycleLength;
+}
+
+TypeId
+BackoffSlotHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BackoffSlotHeader")
+    .SetParent<Header> ()
+    .AddConstructor<BackoffSlotHeader> ()
+  ;
+  return tid;
+}
+TypeId
+BackoffSlotHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+void
+BackoffSlotHeader::Print (std::ostream &os) const
+{
+  os << "slot=" << m_slot << "/" << m_cycleLength;
+}
+
+uint8_t
+BackoffSlotHeader::GetSubtype (void) const
+{
+  return BACKOFF_SLOT;
+}
+uint32_t
+BackoffSlotHeader::GetBodySize (void) const
+{
+  return 2 + 2;
+}
+void
+BackoffSlotHeader::SerializeBody (Buffer::Iterator &i) const
+{
+  i.WriteHtolsbU16 (m_slot);
+  i.WriteHtolsbU16 (m_cycleLength);
+}
+void
+BackoffSlotHeader::DeserializeBody (Buffer::Iterator &i)
+{
+  m_slot = i.ReadLsbtohU16 ();
+  m_cycleLength = i.ReadLsbtohU16 ();
+}
+
+/***********************************************************
+ *          BSS load
+ ***********************************************************/
+
+NS_OBJECT_ENSURE_REGISTERED (BssLoadHeader)
+  ;
+
+BssLoadHeader::BssLoadHeader ()
+  : m_stationCount (0),
+    m_utilization (0)
+{
+}
+
+void
+BssLoadHeader::SetStationCount (uint16_t count)
+{
+  m_stationCount = count;
+}
+void
+BssLoadHeader::SetChannelUtilization (uint8_t utilization)
+{
+  m_utilization = utilization;
+}
+uint16_t
+BssLoadHeader::GetStationCount (void) const
+{
+  return m_stationCount;
+}
+uint8_t
+BssLoadHeader::GetChannelUtilization (void) const
+{
+  return m_utilization;
+}
+
+TypeId
+BssLoadHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BssLoadHeader")
+    .SetParent<Header> ()
+    .AddConstructor<BssLoadHeader> ()
+  ;
+  return tid;
+}
+TypeId
+BssLoadHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+void
+BssLoadHeader::Print (std::ostream &os) const
+{
+  os << "stations=" << m_stationCount
+     << ", utilization=" << (uint32_t) m_utilization << "/255";
+}
+
+uint8_t
+BssLoadHeader::GetSubtype (void) const
+{
+  return BSS_LOAD;
+}
+uint32_t
+BssLoadHeader::GetBodySize (void) const
+{
+  return 2 + 1;
+}
+void
+BssLoadHeader::SerializeBody (Buffer::Iterator &i) const
+{
+  i.WriteHtolsbU16 (m_stationCount);
+  i.WriteU8 (m_utilization);
+}
+void
+BssLoadHeader::DeserializeBody (Buffer::Iterator &i)
+{
+  m_stationCount = i.ReadLsbtohU16 ();
+  m_utilization = i.ReadU8 ();
+}
+
+/***********************************************************
+ *          BSS redirection
+ ***********************************************************/
+
+NS_OBJECT_ENSURE_REGISTERED (BssRedirectHeader)
+  ;
+
+void
+BssRedirectHeader::SetTarget (Mac48Address bssid)
+{
+  m_target = bssid;
+}
+Mac48Address
+BssRedirectHeader::GetTarget (void) const
+{
+  return m_target;
+}
+
+TypeId
+BssRedirectHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BssRedirectHeader")
+    .SetParent<Header> ()
+    .AddConstructor<BssRedirectHeader> ()
+  ;
+  return tid;
+}
+TypeId
+BssRedirectHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+void
+BssRedirectHeader::Print (std::ostream &os) const
+{
+  os << "target=" << m_target;
+}
+
+uint8_t
+BssRedirectHeader::GetSubtype (void) const
+{
+  return BSS_REDIRECT;
+}
+uint32_t
+BssRedirectHeader::GetBodySize (void) const
+{
+  return 6;
+}
+void
+BssRedirectHeader::SerializeBody (Buffer::Iterator &i) const
+{
+  WriteTo (i, m_target);
+}
+void
+BssRedirectHeader::DeserializeBody (Buffer::Iterator &i)
+{
+  ReadFrom (i, m_target);
+}
+
+} // namespace ns3
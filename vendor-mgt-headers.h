@@ -0,0 +1,268 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef VENDOR_MGT_HEADERS_H
+#define VENDOR_MGT_HEADERS_H
+
+#include <stdint.h>
+#include "ns3/header.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+#include "ns3/mac48-address.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ *
+ * Base class of the vendor specific information elements (element ID
+ * 221) that our APs append to their management frames, after the
+ * standard management header. Each element starts with the element ID,
+ * its length, an OUI and a subtype which identifies the element.
+ */
+class VendorSpecificElement : public Header
+{
+public:
+  enum Subtype
+  {
+    UPLINK_WINDOW = 1,
+    CF_POLLABLE = 2,
+    BACKOFF_SLOT = 3,
+    BSS_LOAD = 4,
+    BSS_REDIRECT = 5
+  };
+
+  /**
+   * \param packet a packet whose next bytes may hold a vendor specific
+   *        element
+   * \param subtype the subtype of the element, if any
+   * \param size the serialized size of the element, if any
+   * \return true if the packet starts with one of our vendor specific
+   *         elements, false otherwise
+   */
+  static bool Peek (Ptr<const Packet> packet, uint8_t *subtype, uint32_t *size);
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+protected:
+  /**
+   * \return the subtype of this element
+   */
+  virtual uint8_t GetSubtype (void) const = 0;
+  /**
+   * \return the number of bytes following the subtype
+   */
+  virtual uint32_t GetBodySize (void) const = 0;
+  /**
+   * \param i where to write the bytes following the subtype
+   */
+  virtual void SerializeBody (Buffer::Iterator &i) const = 0;
+  /**
+   * \param i where to read the bytes following the subtype
+   */
+  virtual void DeserializeBody (Buffer::Iterator &i) = 0;
+};
+
+/**
+ * \ingroup wifi
+ *
+ * Announces the uplink access windows of a BSS in beacons. Right
+ * after the beacon, the STAs of group 0 may contend for the medium for
+ * the duration of one window, then the STAs of group 1, and so on; the
+ * cycle repeats until the next beacon. The group of a STA is its MAC
+ * address modulo the number of groups, which is unrelated to the
+ * grouping of the downlink scheduler. The windows gate the DCF of the
+ * STAs only, not their EDCA functions.
+ */
+class UplinkWindowHeader : public VendorSpecificElement
+{
+public:
+  UplinkWindowHeader ();
+
+  /**
+   * \param groups the number of STA groups
+   */
+  void SetGroups (uint8_t groups);
+  /**
+   * \param duration the duration of the window of each group
+   */
+  void SetWindowDuration (Time duration);
+  /**
+   * \return the number of STA groups
+   */
+  uint8_t GetGroups (void) const;
+  /**
+   * \return the duration of the window of each group
+   */
+  Time GetWindowDuration (void) const;
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+
+private:
+  virtual uint8_t GetSubtype (void) const;
+  virtual uint32_t GetBodySize (void) const;
+  virtual void SerializeBody (Buffer::Iterator &i) const;
+  virtual void DeserializeBody (Buffer::Iterator &i);
+
+  uint8_t m_groups;
+  uint32_t m_windowUs;
+};
+
+/**
+ * \ingroup wifi
+ *
+ * Appended by the AP to its successful association responses to give
+ * the STA a backoff slot of its own: the STA draws its first backoff as
+ * this slot and, after each success, waits for the rest of the cycle
+ * instead of drawing a random backoff.
+ */
+class BackoffSlotHeader : public VendorSpecificElement
+{
+public:
+  BackoffSlotHeader ();
+
+  /**
+   * \param slot the backoff slot assigned to the STA
+   */
+  void SetSlot (uint16_t slot);
+  /**
+   * \param length the number of slots of a cycle
+   */
+  void SetCycleLength (uint16_t length);
+  /**
+   * \return the backoff slot assigned to the STA
+   */
+  uint16_t GetSlot (void) const;
+  /**
+   * \return the number of slots of a cycle
+   */
+  uint16_t GetCycleLength (void) const;
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+
+private:
+  virtual uint8_t GetSubtype (void) const;
+  virtual uint32_t GetBodySize (void) const;
+  virtual void SerializeBody (Buffer::Iterator &i) const;
+  virtual void DeserializeBody (Buffer::Iterator &i);
+
+  uint16_t m_slot;
+  uint16_t m_cycleLength;
+};
+
+/**
+ * \ingroup wifi
+ *
+ * Appended by a STA to its association requests to ask the AP to poll
+ * it during the contention-free periods. The element has no body.
+ */
+class CfPollableHeader : public VendorSpecificElement
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+
+private:
+  virtual uint8_t GetSubtype (void) const;
+  virtual uint32_t GetBodySize (void) const;
+  virtual void SerializeBody (Buffer::Iterator &i) const;
+  virtual void DeserializeBody (Buffer::Iterator &i);
+};
+
+/**
+ * \ingroup wifi
+ *
+ * Advertises the load of a BSS in beacons and probe responses, with
+ * the same fields as the BSS Load element of IEEE 802.11: the number of
+ * associated stations and the fraction of the time, in units of 1/255,
+ * during which the AP sensed the medium busy.
+ */
+class BssLoadHeader : public VendorSpecificElement
+{
+public:
+  BssLoadHeader ();
+
+  /**
+   * \param count the number of associated stations
+   */
+  void SetStationCount (uint16_t count);
+  /**
+   * \param utilization the channel utilization, from 0 to 255
+   */
+  void SetChannelUtilization (uint8_t utilization);
+  /**
+   * \return the number of associated stations
+   */
+  uint16_t GetStationCount (void) const;
+  /**
+   * \return the channel utilization, from 0 to 255
+   */
+  uint8_t GetChannelUtilization (void) const;
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+
+private:
+  virtual uint8_t GetSubtype (void) const;
+  virtual uint32_t GetBodySize (void) const;
+  virtual void SerializeBody (Buffer::Iterator &i) const;
+  virtual void DeserializeBody (Buffer::Iterator &i);
+
+  uint16_t m_stationCount;
+  uint8_t m_utilization;
+};
+
+/**
+ * \ingroup wifi
+ *
+ * Appended by an AP to the association responses by which it refuses a
+ * STA, to point the STA to another AP.
+ */
+class BssRedirectHeader : public VendorSpecificElement
+{
+public:
+  /**
+   * \param bssid the BSSID of the AP the STA should associate with
+   */
+  void SetTarget (Mac48Address bssid);
+  /**
+   * \return the BSSID of the AP the STA should associate with
+   */
+  Mac48Address GetTarget (void) const;
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+
+private:
+  virtual uint8_t GetSubtype (void) const;
+  virtual uint32_t GetBodySize (void) const;
+  virtual void SerializeBody (Buffer::Iterator &i) const;
+  virtual void DeserializeBody (Buffer::Iterator &i);
+
+  Mac48Address m_target;
+};
+
+} // namespace ns3
+
+#endif /* VENDOR_MGT_HEADERS_H */
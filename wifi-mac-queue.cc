@@ -27,6 +27,7 @@
 
 #include "wifi-mac-queue.h"
 #include "qos-blocked-destinations.h"
+#include "association-table.h"
 
 namespace ns3 {
 
@@ -243,6 +244,53 @@ WifiMacQueue::DequeueByAddresses (WifiMacHeader *hdr, std::list<Mac48Address> de
   return 0;
 }
 Ptr<const Packet>
+WifiMacQueue::DequeueByAids (WifiMacHeader *hdr, const AssociationTable &table,
+                             const std::vector<Mac48Address> &scheduled,
+                             const std::vector<Mac48Address> &held)
+{
+  Cleanup ();
+  if (m_queue.empty ())
+    {
+      return 0;
+    }
+  PacketQueueI it = m_queue.begin ();
+  if (!it->hdr.GetAddr1 ().IsBroadcast () && !it->hdr.IsMgt ())
+    {
+      PacketQueueI firstNotHeld = m_queue.end ();
+      for (; it != m_queue.end (); ++it)
+        {
+          uint16_t aid = table.GetAid (it->hdr.GetAddr1 ());
+          if (aid != 0 && aid < held.size ()
+              && held[aid] == it->hdr.GetAddr1 ())
+            {
+              continue;
+            }
+          if (firstNotHeld == m_queue.end ())
+            {
+              firstNotHeld = it;
+            }
+          if (aid != 0 && aid < scheduled.size ()
+              && scheduled[aid] == it->hdr.GetAddr1 ())
+            {
+              break;
+            }
+        }
+      if (it == m_queue.end ())
+        {
+          it = firstNotHeld != m_queue.end () ? firstNotHeld : m_queue.begin ();
+        }
+      else
+        {
+          std::cout<<"T="<<Simulator::Now().GetSeconds()<<"size="<<m_size - 1<<"dequeue p="<<*it->packet<<std::endl;
+        }
+    }
+  Ptr<const Packet> packet = it->packet;
+  *hdr = it->hdr;
+  m_queue.erase (it);
+  m_size--;
+  return packet;
+}
+Ptr<const Packet>
 WifiMacQueue::Peek (WifiMacHeader *hdr)
 {
   Cleanup ();
@@ -376,6 +424,20 @@ WifiMacQueue::PushFront (Ptr<const Packet> packet, const WifiMacHeader &hdr)
   m_size++;
 }
 
+bool
+WifiMacQueue::Requeue (Ptr<const Packet> packet, const WifiMacHeader &hdr, Time tstamp)
+{
+  Cleanup ();
+  if (m_size == m_maxSize
+      || tstamp + m_maxDelay <= Simulator::Now ())
+    {
+      return false;
+    }
+  m_queue.push_front (Item (packet, hdr, tstamp));
+  m_size++;
+  return true;
+}
+
 uint32_t
 WifiMacQueue::GetNPacketsByTidAndAddress (uint8_t tid, WifiMacHeader::AddressType type,
                                           Mac48Address addr)
@@ -23,6 +23,7 @@
 #define WIFI_MAC_QUEUE_H
 
 #include <list>
+#include <vector>
 #include <utility>
 #include "ns3/packet.h"
 #include "ns3/nstime.h"
@@ -32,6 +33,7 @@
 
 namespace ns3 {
 class QosBlockedDestinations;
+class AssociationTable;
 
 /**
  * \ingroup wifi
@@ -94,6 +96,19 @@ public:
    * \param hdr the header of the given packet
    */
   void PushFront (Ptr<const Packet> packet, const WifiMacHeader &hdr);
+  /**
+   * Put a packet dequeued earlier back at the <i>front</i> of the queue.
+   * The packet keeps the time it was first enqueued, so that it is not
+   * given a new MaxDelay. Unlike PushFront, the packet is not dropped
+   * silently: the caller is told when it cannot be queued.
+   *
+   * \param packet the packet to be queued again
+   * \param hdr the header of the given packet
+   * \param tstamp the time the packet was first enqueued
+   * \return false if the queue is full or the packet has outlived the
+   *         maximum delay, true otherwise
+   */
+  bool Requeue (Ptr<const Packet> packet, const WifiMacHeader &hdr, Time tstamp);
   /**
    * Dequeue the packet in the front of the queue.
    *
@@ -102,6 +117,25 @@ public:
    */
   Ptr<const Packet> Dequeue (WifiMacHeader *hdr);
   Ptr<const Packet> DequeueByAddresses(WifiMacHeader *hdr,std::list<Mac48Address> clients,std::list<Mac48Address> m_clients);
+  /**
+   * Same as DequeueByAddresses, with the scheduled destinations given
+   * by AID: a broadcast or management frame at the front of the queue
+   * is dequeued first, then the first frame for a scheduled destination
+   * which is not held off. If there is none, the first frame for a
+   * destination which is not held off is dequeued, and the frame at the
+   * front of the queue if all the destinations are held off.
+   *
+   * \param hdr the WifiMacHeader of the packet
+   * \param table the association table which gives the AIDs
+   * \param scheduled the address of each scheduled destination at the
+   *        index of its AID, and any other address elsewhere
+   * \param held the address of each destination held off at the index
+   *        of its AID, and any other address elsewhere
+   * \return the packet
+   */
+  Ptr<const Packet> DequeueByAids (WifiMacHeader *hdr, const AssociationTable &table,
+                                   const std::vector<Mac48Address> &scheduled,
+                                   const std::vector<Mac48Address> &held);
   /**
    * Peek the packet in the front of the queue. The packet is not removed.
    *